@@ -0,0 +1,531 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "Benchmarks.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstdio>
+
+#include "BoxMesh.h"
+#include "BoxBounds.h"
+#include "BoxObject.h"
+#include "BoxBVH.h"
+#include "BoxImporter.h"
+#include "BoxStore.h"
+#include "MeshOptimizer.h"
+#include "PickObject.h"
+
+/*! Generates count boxes on a lattice, similar to the BoxObject constructor.
+	BoxContainer is either std::vector<BoxMesh> or BoxStore.
+*/
+template <typename BoxContainer>
+static void generateBoxes(unsigned int count, BoxContainer & boxes) {
+	const int BoxGridSize = 5;
+	const int GridDim = 100;
+	std::vector<int> boxPerCells(GridDim*GridDim, 0);
+
+	boxes.clear();
+	boxes.reserve(count);
+	Transform3D trans;
+	for (unsigned int i=0; i<count; ++i) {
+		int xGrid = qrand() % GridDim;
+		int zGrid = qrand() % GridDim;
+		int boxCount = boxPerCells[xGrid*GridDim + zGrid]++;
+		float boxHeight = 4.5;
+		BoxMesh b(4,boxHeight,3);
+		trans.setTranslation((-GridDim/2+xGrid)*BoxGridSize, boxCount*BoxGridSize + 0.5*boxHeight, (-GridDim/2 + zGrid)*BoxGridSize);
+		b.transform(trans.toMatrix());
+		boxes.push_back(b);
+	}
+}
+
+
+/*! Generates pick lines from points in front of and above the box field to points behind/below it. */
+static void generatePickLines(unsigned int count, std::vector<QVector3D> & p1, std::vector<QVector3D> & d) {
+	p1.resize(count);
+	d.resize(count);
+	for (unsigned int i=0; i<count; ++i) {
+		p1[i] = QVector3D(qrand() % 600 - 300, 20 + qrand() % 200, 300 + qrand() % 100);
+		QVector3D p2(qrand() % 600 - 300, -10, -300 + qrand() % 100);
+		d[i] = p2 - p1[i];
+	}
+}
+
+
+int runBenchmarks() {
+	int result = 0;
+	benchmarkPickKernels();
+	benchmarkParallelPick();
+	benchmarkBVHUpdates();
+	if (!benchmarkRectTests())
+		result = 1;
+	benchmarkBoxStore();
+	benchmarkImport();
+	benchmarkVertexCache();
+	return result;
+}
+
+
+void benchmarkPickKernels() {
+	qDebug() << "*** Picking: per-face test vs. slab test ***";
+	qsrand(1); // same scene each run
+
+	const unsigned int BoxCounts[] = {10000, 100000, 1000000};
+	for (unsigned int boxCount : BoxCounts) {
+		std::vector<BoxMesh> boxes;
+		generateBoxes(boxCount, boxes);
+		BoxBounds bounds;
+		bounds.resize(boxes.size());
+		for (unsigned int i=0; i<boxes.size(); ++i) {
+			QVector3D minCorner, maxCorner;
+			boxes[i].boundingBox(minCorner, maxCorner);
+			bounds.set(i, minCorner, maxCorner);
+		}
+
+		// the per-face test is slow, so use fewer lines for large scenes
+		unsigned int lineCount = boxCount > 100000 ? 10 : 100;
+		std::vector<QVector3D> p1, d;
+		generatePickLines(lineCount, p1, d);
+
+		std::vector<PickObject> refResults;
+		QElapsedTimer t;
+		t.start();
+		for (unsigned int l=0; l<lineCount; ++l) {
+			PickObject po(2.f, std::numeric_limits<unsigned int>::max());
+			for (unsigned int i=0; i<boxes.size(); ++i) {
+				for (unsigned int j=0; j<6; ++j) {
+					float dist;
+					if (boxes[i].intersects(j, p1[l], d[l], dist) && dist < po.m_dist) {
+						po.m_dist = dist;
+						po.m_objectId = i;
+						po.m_faceId = j;
+					}
+				}
+			}
+			refResults.push_back(po);
+		}
+		double perFaceMs = t.nsecsElapsed()*1e-6/lineCount;
+
+		// slab tests, followed by face test of closest box only
+		unsigned int mismatches = 0;
+		double slabMs[2];
+		for (int k=0; k<2; ++k) {
+			t.start();
+			for (unsigned int l=0; l<lineCount; ++l) {
+				float tEnter;
+				int boxId = (k == 0) ? nearestSlabHitScalar(bounds, p1[l], d[l], 1, tEnter) : nearestSlabHit(bounds, p1[l], d[l], 1, tEnter);
+				PickObject po(2.f, std::numeric_limits<unsigned int>::max());
+				if (boxId != -1) {
+					for (unsigned int j=0; j<6; ++j) {
+						float dist;
+						if (boxes[boxId].intersects(j, p1[l], d[l], dist) && dist < po.m_dist) {
+							po.m_dist = dist;
+							po.m_objectId = boxId;
+							po.m_faceId = j;
+						}
+					}
+				}
+				if (po.m_objectId != refResults[l].m_objectId || po.m_faceId != refResults[l].m_faceId)
+					++mismatches;
+			}
+			slabMs[k] = t.nsecsElapsed()*1e-6/lineCount;
+		}
+
+		qDebug().nospace() << boxCount << " boxes: per-face " << perFaceMs << " ms/pick, slab test (scalar) "
+						   << slabMs[0] << " ms/pick, slab test (SIMD) " << slabMs[1] << " ms/pick, speedup "
+						   << perFaceMs/slabMs[1] << ", mismatches " << mismatches;
+	}
+}
+
+
+void benchmarkParallelPick() {
+	qDebug() << "*** Picking: single-threaded vs. parallel per-face test ("
+			 << QThreadPool::globalInstance()->maxThreadCount() << "threads) ***";
+	qsrand(1);
+
+	const unsigned int BoxCounts[] = {100000, 1000000};
+	const unsigned int ChunkSizes[] = {1024, 8192, 65536};
+	for (unsigned int boxCount : BoxCounts) {
+		BoxObject boxObject;
+		generateBoxes(boxCount, boxObject.m_boxes);
+		boxObject.m_pickMethod = BoxObject::PM_Parallel;
+
+		unsigned int lineCount = boxCount > 100000 ? 10 : 100;
+		std::vector<QVector3D> p1, d;
+		generatePickLines(lineCount, p1, d);
+
+		// a single chunk is processed by the calling thread only
+		boxObject.m_pickChunkSize = boxCount;
+		std::vector<PickObject> refResults;
+		QElapsedTimer t;
+		t.start();
+		for (unsigned int l=0; l<lineCount; ++l) {
+			PickObject po(2.f, std::numeric_limits<unsigned int>::max());
+			boxObject.pick(p1[l], d[l], po);
+			refResults.push_back(po);
+		}
+		double singleMs = t.nsecsElapsed()*1e-6/lineCount;
+		qDebug().nospace() << boxCount << " boxes: single-threaded " << singleMs << " ms/pick";
+
+		for (unsigned int chunkSize : ChunkSizes) {
+			boxObject.m_pickChunkSize = chunkSize;
+			unsigned int mismatches = 0;
+			t.start();
+			for (unsigned int l=0; l<lineCount; ++l) {
+				PickObject po(2.f, std::numeric_limits<unsigned int>::max());
+				boxObject.pick(p1[l], d[l], po);
+				if (po.m_objectId != refResults[l].m_objectId || po.m_faceId != refResults[l].m_faceId)
+					++mismatches;
+			}
+			double parallelMs = t.nsecsElapsed()*1e-6/lineCount;
+			qDebug().nospace() << "  chunk size " << chunkSize << ": " << parallelMs << " ms/pick, speedup "
+							   << singleMs/parallelMs << ", mismatches " << mismatches;
+		}
+	}
+}
+
+
+void benchmarkBVHUpdates() {
+	qDebug() << "*** BVH: incremental updates vs. rebuild ***";
+	qsrand(1);
+
+	const unsigned int BoxCount = 500000;
+	std::vector<BoxMesh> boxes;
+	generateBoxes(BoxCount, boxes);
+	std::vector<QVector3D> minCorners(BoxCount), maxCorners(BoxCount);
+	for (unsigned int i=0; i<BoxCount; ++i)
+		boxes[i].boundingBox(minCorners[i], maxCorners[i]);
+
+	BoxBVH bvh;
+	QElapsedTimer t;
+	t.start();
+	bvh.build(minCorners, maxCorners);
+	double buildMs = t.nsecsElapsed()*1e-6;
+	qDebug().nospace() << BoxCount << " boxes: build " << buildMs << " ms";
+
+	// each frame, move 100 boxes, and remove and re-insert 10 boxes
+	const unsigned int FrameCount = 100;
+	double moveMs = 0, removeInsertMs = 0;
+	for (unsigned int frame=0; frame<FrameCount; ++frame) {
+		t.start();
+		for (unsigned int k=0; k<100; ++k) {
+			unsigned int boxId = qrand() % BoxCount;
+			QVector3D offset(qrand() % 11 - 5, qrand() % 5 - 2, qrand() % 11 - 5);
+			minCorners[boxId] += offset;
+			maxCorners[boxId] += offset;
+			bvh.update(boxId, minCorners[boxId], maxCorners[boxId]);
+		}
+		moveMs += t.nsecsElapsed()*1e-6;
+
+		t.start();
+		for (unsigned int k=0; k<10; ++k) {
+			unsigned int boxId = qrand() % BoxCount;
+			bvh.remove(boxId);
+			bvh.insert(boxId, minCorners[boxId], maxCorners[boxId]);
+		}
+		removeInsertMs += t.nsecsElapsed()*1e-6;
+	}
+	qDebug().nospace() << "  per frame: 100 moves " << moveMs/FrameCount << " ms, 10 removals/insertions "
+					   << removeInsertMs/FrameCount << " ms, degradation after " << FrameCount << " frames "
+					   << bvh.degradation();
+
+	// the updated tree must find the same nearest bounding box as the slab test over all boxes
+	BoxBounds bounds;
+	bounds.resize(BoxCount);
+	for (unsigned int i=0; i<BoxCount; ++i)
+		bounds.set(i, minCorners[i], maxCorners[i]);
+	std::vector<QVector3D> p1, d;
+	generatePickLines(1000, p1, d);
+	unsigned int mismatches = 0;
+	for (unsigned int l=0; l<p1.size(); ++l) {
+		float tRef;
+		int refBoxId = nearestSlabHitScalar(bounds, p1[l], d[l], 1, tRef);
+		float tBest = 1;
+		int boxIdBest = -1;
+		QVector3D invD(1.f/d[l].x(), 1.f/d[l].y(), 1.f/d[l].z());
+		bvh.traverse(p1[l], d[l], 1, [&](unsigned int boxId, float & tMax) {
+			BoxBVH::Node n;
+			n.m_min = minCorners[boxId];
+			n.m_max = maxCorners[boxId];
+			float tEnter;
+			if (BoxBVH::intersects(n, p1[l], invD, tMax, tEnter) && tEnter < tBest) {
+				tBest = tEnter;
+				boxIdBest = (int)boxId;
+				tMax = tEnter;
+			}
+		});
+		if ((refBoxId == -1) != (boxIdBest == -1) || (refBoxId != -1 && tRef != tBest))
+			++mismatches;
+	}
+	qDebug() << "  pick mismatches after updates:" << mismatches;
+
+	t.start();
+	bvh.build(minCorners, maxCorners);
+	qDebug().nospace() << "  rebuild " << t.nsecsElapsed()*1e-6 << " ms, degradation " << bvh.degradation();
+}
+
+
+bool benchmarkRectTests() {
+	qDebug() << "*** Line-face intersection: intersectsRect() vs. precomputed face data ***";
+	qsrand(1);
+
+	std::vector<BoxMesh> boxes;
+	generateBoxes(10000, boxes);
+	std::vector<QVector3D> p1, d;
+	generatePickLines(100, p1, d);
+
+	// test all faces of all boxes with both functions, results (hit, distance) must be identical;
+	// distances are line parameters (0..1), so they may only differ by a few float rounding steps
+	const float DistanceTolerance = 1e-6f;
+	unsigned int hitCount[2] = {0, 0};
+	unsigned int mismatches = 0;
+	float maxDistDiff = 0;
+	for (unsigned int l=0; l<p1.size(); ++l) {
+		for (const BoxMesh & b : boxes) {
+			for (unsigned int j=0; j<6; ++j) {
+				float distLegacy = -1, dist = -1;
+				bool hitLegacy = b.intersectsLegacy(j, p1[l], d[l], distLegacy);
+				bool hit = b.intersects(j, p1[l], d[l], dist);
+				hitCount[0] += hitLegacy;
+				hitCount[1] += hit;
+				if (hit != hitLegacy)
+					++mismatches;
+				else if (hit)
+					maxDistDiff = std::max(maxDistDiff, std::fabs(dist - distLegacy));
+			}
+		}
+	}
+	qDebug().nospace() << "hits: legacy " << hitCount[0] << ", new " << hitCount[1] << ", mismatches " << mismatches
+					   << ", max. distance difference " << maxDistDiff;
+	bool identical = (mismatches == 0 && maxDistDiff <= DistanceTolerance);
+	if (!identical)
+		qWarning() << "FAILED: intersects() and intersectsLegacy() differ (distance tolerance" << DistanceTolerance << ")";
+
+	// timing
+	double ms[2];
+	unsigned int hits = 0;
+	for (int k=0; k<2; ++k) {
+		QElapsedTimer t;
+		t.start();
+		for (unsigned int l=0; l<p1.size(); ++l) {
+			for (const BoxMesh & b : boxes) {
+				for (unsigned int j=0; j<6; ++j) {
+					float dist;
+					hits += (k == 0) ? b.intersectsLegacy(j, p1[l], d[l], dist) : b.intersects(j, p1[l], d[l], dist);
+				}
+			}
+		}
+		ms[k] = t.nsecsElapsed()*1e-6/p1.size();
+	}
+	qDebug().nospace() << "10000 boxes: legacy " << ms[0] << " ms/pick, precomputed " << ms[1] << " ms/pick, speedup "
+					   << ms[0]/ms[1] << " (" << hits << " hits)";
+	return identical;
+}
+
+
+void benchmarkBoxStore() {
+	qDebug() << "*** Box storage: std::vector<BoxMesh> vs. BoxStore ***";
+
+	const unsigned int BoxCount = 1000000;
+	std::vector<QVector3D> p1, d;
+	qsrand(2);
+	generatePickLines(10, p1, d);
+
+	// build, same boxes in both containers
+	QElapsedTimer t;
+	std::vector<BoxMesh> meshes;
+	qsrand(1);
+	t.start();
+	generateBoxes(BoxCount, meshes);
+	double meshBuildMs = t.nsecsElapsed()*1e-6;
+
+	BoxStore store;
+	qsrand(1);
+	t.start();
+	generateBoxes(BoxCount, store);
+	double storeBuildMs = t.nsecsElapsed()*1e-6;
+
+	size_t meshMem = (meshes.capacity() - meshes.size())*sizeof(BoxMesh);
+	for (const BoxMesh & b : meshes)
+		meshMem += b.memSize();
+	qDebug().nospace() << BoxCount << " boxes: memory BoxMesh " << meshMem/(1024*1024) << " MB ("
+					   << BoxCount*3 << " heap allocations), BoxStore " << store.memSize()/(1024*1024) << " MB";
+	qDebug().nospace() << "  build: BoxMesh " << meshBuildMs << " ms, BoxStore " << storeBuildMs << " ms";
+
+	// pick by testing all faces of all boxes
+	double ms[2];
+	unsigned int mismatches = 0;
+	std::vector<unsigned int> meshHits(p1.size(), std::numeric_limits<unsigned int>::max());
+	for (int k=0; k<2; ++k) {
+		t.start();
+		for (unsigned int l=0; l<p1.size(); ++l) {
+			float bestDist = 2;
+			unsigned int hit = std::numeric_limits<unsigned int>::max();
+			for (unsigned int i=0; i<BoxCount; ++i) {
+				for (unsigned int j=0; j<6; ++j) {
+					float dist;
+					bool h = (k == 0) ? meshes[i].intersects(j, p1[l], d[l], dist) : store.intersects(i, j, p1[l], d[l], dist);
+					if (h && dist < bestDist) {
+						bestDist = dist;
+						hit = i*6 + j;
+					}
+				}
+			}
+			if (k == 0)
+				meshHits[l] = hit;
+			else if (hit != meshHits[l])
+				++mismatches;
+		}
+		ms[k] = t.nsecsElapsed()*1e-6/p1.size();
+	}
+	qDebug().nospace() << "  pick: BoxMesh " << ms[0] << " ms/pick, BoxStore " << ms[1] << " ms/pick, speedup "
+					   << ms[0]/ms[1] << ", mismatches " << mismatches;
+}
+
+
+/*! Writes a file with boxes in the given import format, until the file has at least fileSize bytes. */
+static bool writeImportFile(const QString & fileName, BoxImporter::Format format, quint64 fileSize) {
+	QFile f(fileName);
+	if (!f.open(QIODevice::WriteOnly))
+		return false;
+	// boxes of a building (rooms with walls in x and z direction) on several floors
+	QByteArray buffer;
+	buffer.reserve(1024*1024 + 1024);
+	char line[256];
+	if (format == BoxImporter::F_CSV)
+		buffer.append("x,y,z,width,height,depth,color\n");
+	else if (format == BoxImporter::F_JSON)
+		buffer.append("[\n");
+	quint64 written = 0;
+	for (unsigned int i=0; written + buffer.size() < fileSize; ++i) {
+		float x = (qrand() % 20000)*0.05f;
+		float y = (qrand() % 100)*3.f + 1.5f;
+		float z = (qrand() % 20000)*0.05f;
+		float w = 0.5f + (qrand() % 100)*0.1f;
+		float h = 3.f;
+		float d = 0.2f + (qrand() % 10)*0.05f;
+		if (i % 2 == 1)
+			std::swap(w, d);
+		unsigned int color = (unsigned int)qrand() & 0xFFFFFF;
+		int len = 0;
+		switch (format) {
+			case BoxImporter::F_CSV :
+				len = std::snprintf(line, sizeof(line), "%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,#%06x\n", x, y, z, w, h, d, color);
+			break;
+			case BoxImporter::F_JSON :
+				len = std::snprintf(line, sizeof(line), "%s{\"center\": [%.3f, %.3f, %.3f], \"size\": [%.3f, %.3f, %.3f], \"color\": \"#%06x\"}",
+									i == 0 ? "  " : ",\n  ", x, y, z, w, h, d, color);
+			break;
+			default :
+				// a vertical rectangle (front side of the wall) with relative vertex indexes
+				len = std::snprintf(line, sizeof(line), "v %.3f %.3f %.3f\nv %.3f %.3f %.3f\nv %.3f %.3f %.3f\nv %.3f %.3f %.3f\nf -4 -3 -2 -1\n",
+									x, y, z, x + w, y, z, x + w, y + h, z, x, y + h, z);
+		}
+		buffer.append(line, len);
+		if (buffer.size() > 1024*1024) {
+			if (f.write(buffer) != buffer.size())
+				return false;
+			written += buffer.size();
+			buffer.clear();
+		}
+	}
+	if (format == BoxImporter::F_JSON)
+		buffer.append("\n]\n");
+	return f.write(buffer) == buffer.size();
+}
+
+
+void benchmarkImport() {
+	qDebug() << "*** Import: throughput of BoxImporter ***";
+	qsrand(1);
+
+	const quint64 FileSize = 1024*1024*1024;
+	const char * const FormatNames[BoxImporter::NUM_F] = {"csv", "json", "obj"};
+	const int MaxThreadCount = QThreadPool::globalInstance()->maxThreadCount();
+	for (int format=0; format<BoxImporter::NUM_F; ++format) {
+		QString fileName = QDir::temp().filePath(QString("boximport_benchmark.%1").arg(FormatNames[format]));
+		QElapsedTimer t;
+		t.start();
+		if (!writeImportFile(fileName, BoxImporter::Format(format), FileSize)) {
+			qDebug() << "Cannot write" << fileName;
+			QFile::remove(fileName);
+			continue;
+		}
+		qDebug().nospace() << FormatNames[format] << ": " << QFile(fileName).size()/(1024*1024) << " MB generated in "
+						   << t.elapsed() << " ms";
+
+		// the first pass also brings the file into the page cache, so that both passes measure parsing only
+		const int ThreadCounts[] = {1, MaxThreadCount};
+		for (int threadCount : ThreadCounts) {
+			QThreadPool::globalInstance()->setMaxThreadCount(threadCount);
+			BoxImporter importer;
+			t.start();
+			if (!importer.start(fileName))
+				break;
+			// boxes are taken as in SceneView, but not kept
+			unsigned int boxCount = 0;
+			while (importer.isRunning()) {
+				BoxStore boxes;
+				boxCount += importer.takeBoxes(boxes, true);
+			}
+			double secs = t.nsecsElapsed()*1e-9;
+			qDebug().nospace() << "  " << threadCount << " thread(s): " << boxCount << " boxes ("
+							   << importer.m_skippedRecords << " skipped) in " << secs << " s, "
+							   << importer.fileSize()/(1024*1024)/secs << " MB/s";
+		}
+		QThreadPool::globalInstance()->setMaxThreadCount(MaxThreadCount);
+		QFile::remove(fileName);
+	}
+}
+
+
+void benchmarkVertexCache() {
+	qDebug() << "*** Vertex cache: ACMR of a shuffled grid mesh before and after optimizeVertexCache() ***";
+	qsrand(1);
+
+	// 100x100 quads with shared vertexes, two triangles per quad
+	const unsigned int GridDim = 100;
+	std::vector<GLuint> indexes;
+	indexes.reserve(GridDim*GridDim*6);
+	for (unsigned int j=0; j<GridDim; ++j) {
+		for (unsigned int i=0; i<GridDim; ++i) {
+			GLuint a = j*(GridDim+1) + i;
+			GLuint b = a + 1;
+			GLuint c = b + GridDim + 1;
+			GLuint d = a + GridDim + 1;
+			const GLuint quad[6] = {a, b, d, b, c, d};
+			indexes.insert(indexes.end(), quad, quad + 6);
+		}
+	}
+	qDebug() << "  grid in row order: ACMR" << averageCacheMissRatio(indexes.data(), indexes.size());
+
+	// shuffle the triangles, as in a mesh without any useful triangle order
+	unsigned int triangleCount = indexes.size()/3;
+	for (unsigned int i=triangleCount-1; i>0; --i) {
+		unsigned int k = qrand() % (i+1);
+		std::swap_ranges(indexes.begin() + 3*i, indexes.begin() + 3*i + 3, indexes.begin() + 3*k);
+	}
+	double acmr = averageCacheMissRatio(indexes.data(), indexes.size());
+
+	QElapsedTimer t;
+	t.start();
+	optimizeVertexCache(indexes.data(), indexes.size());
+	qDebug().nospace() << "  shuffled grid: ACMR " << acmr << " -> " << averageCacheMissRatio(indexes.data(), indexes.size())
+					   << " in " << t.nsecsElapsed()*1e-6 << " ms";
+}
@@ -0,0 +1,58 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+/*! Runs all benchmarks and prints the results via qDebug().
+	Enable with "OPTIONS += benchmarks" in the project file, the program then runs
+	the benchmarks instead of opening the window.
+	Returns 1 if a benchmark detected wrong results (used as exit code), otherwise 0.
+*/
+int runBenchmarks();
+
+/*! Compares picking by testing all faces of all boxes with the vectorized slab test
+	for 10k, 100k and 1M boxes.
+*/
+void benchmarkPickKernels();
+
+/*! Compares picking by testing all faces of all boxes on a single thread with the
+	parallel pick (BoxObject::PM_Parallel) for different chunk sizes.
+*/
+void benchmarkParallelPick();
+
+/*! Measures incremental updates of the bounding volume hierarchy (moving, removing and inserting
+	boxes) in a scene of 500k boxes, compared to rebuilding the tree, and checks picking afterwards.
+*/
+void benchmarkBVHUpdates();
+
+/*! Checks that BoxMesh::intersects() and BoxMesh::intersectsLegacy() give identical results and compares their speed.
+	Returns false if hits differ or hit distances differ by more than 1e-6.
+*/
+bool benchmarkRectTests();
+
+/*! Compares memory footprint, build time and brute-force pick time of 1M boxes stored as
+	std::vector<BoxMesh> and in a BoxStore.
+*/
+void benchmarkBoxStore();
+
+/*! Generates a 1 GB file in each import format (CSV, JSON, OBJ) in the temporary directory and measures
+	the import throughput of BoxImporter in MB/s, with a single thread and with all threads of the global
+	thread pool.
+*/
+void benchmarkImport();
+
+/*! Reports the average cache miss ratio (ACMR) of a 100x100 grid mesh with shuffled triangles,
+	before and after optimizeVertexCache().
+*/
+void benchmarkVertexCache();
+
+#endif // BENCHMARKS_H
@@ -0,0 +1,262 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "BoxBVH.h"
+
+#include <algorithm>
+
+void BoxBVH::build(const std::vector<QVector3D> & minCorners, const std::vector<QVector3D> & maxCorners) {
+	Q_ASSERT(minCorners.size() == maxCorners.size());
+	clear();
+	if (minCorners.empty())
+		return;
+
+	// a binary tree with one box per leaf has 2*N-1 nodes
+	m_nodes.reserve(2*minCorners.size());
+	m_boxIds.resize(minCorners.size());
+	for (unsigned int i=0; i<m_boxIds.size(); ++i)
+		m_boxIds[i] = (int)i;
+
+	m_leafNodes.resize(minCorners.size());
+	m_root = buildRecursive(0, m_boxIds.size(), -1, minCorners, maxCorners);
+	m_builtInnerArea = m_innerArea;
+
+	// no longer needed
+	m_boxIds = std::vector<int>();
+}
+
+
+void BoxBVH::clear() {
+	m_nodes.clear();
+	m_root = -1;
+	m_leafNodes.clear();
+	m_freeNodes.clear();
+	m_innerArea = 0;
+	m_builtInnerArea = 0;
+}
+
+
+void BoxBVH::insert(unsigned int boxId, const QVector3D & minCorner, const QVector3D & maxCorner) {
+	Q_ASSERT(!contains(boxId));
+	int leaf = allocateNode();
+	m_nodes[leaf] = Node{minCorner, maxCorner, -1, -1, -1, (int)boxId};
+	if (m_leafNodes.size() <= boxId)
+		m_leafNodes.resize(boxId + 1, -1);
+	m_leafNodes[boxId] = leaf;
+
+	if (m_root == -1) {
+		m_root = leaf;
+		return;
+	}
+
+	// descend to the leaf node whose bounding box grows least when the new box is added
+	int sibling = m_root;
+	while (m_nodes[sibling].m_boxId == -1) {
+		const Node & n = m_nodes[sibling];
+		float growth[2];
+		int children[2] = {n.m_left, n.m_right};
+		for (int i=0; i<2; ++i) {
+			const Node & c = m_nodes[children[i]];
+			QVector3D cmin = c.m_min, cmax = c.m_max;
+			for (int j=0; j<3; ++j) {
+				cmin[j] = std::min(cmin[j], minCorner[j]);
+				cmax[j] = std::max(cmax[j], maxCorner[j]);
+			}
+			growth[i] = area(cmin, cmax) - area(c.m_min, c.m_max);
+		}
+		sibling = growth[0] <= growth[1] ? children[0] : children[1];
+	}
+
+	// new inner node replaces the sibling and gets sibling and new leaf as children
+	int oldParent = m_nodes[sibling].m_parent;
+	int parent = allocateNode();
+	QVector3D pmin = m_nodes[sibling].m_min, pmax = m_nodes[sibling].m_max;
+	for (int j=0; j<3; ++j) {
+		pmin[j] = std::min(pmin[j], minCorner[j]);
+		pmax[j] = std::max(pmax[j], maxCorner[j]);
+	}
+	m_nodes[parent] = Node{pmin, pmax, oldParent, sibling, leaf, -1};
+	m_innerArea += area(pmin, pmax);
+	m_nodes[sibling].m_parent = parent;
+	m_nodes[leaf].m_parent = parent;
+	replaceChild(oldParent, sibling, parent);
+	refit(oldParent);
+}
+
+
+void BoxBVH::remove(unsigned int boxId) {
+	Q_ASSERT(contains(boxId));
+	int leaf = m_leafNodes[boxId];
+	m_leafNodes[boxId] = -1;
+	m_freeNodes.push_back(leaf);
+	if (leaf == m_root) {
+		m_root = -1;
+		return;
+	}
+
+	// the sibling takes the place of the parent node
+	int parent = m_nodes[leaf].m_parent;
+	int grandParent = m_nodes[parent].m_parent;
+	int sibling = (m_nodes[parent].m_left == leaf) ? m_nodes[parent].m_right : m_nodes[parent].m_left;
+	m_innerArea -= area(m_nodes[parent].m_min, m_nodes[parent].m_max);
+	m_freeNodes.push_back(parent);
+	m_nodes[sibling].m_parent = grandParent;
+	replaceChild(grandParent, parent, sibling);
+	refit(grandParent);
+}
+
+
+void BoxBVH::update(unsigned int boxId, const QVector3D & minCorner, const QVector3D & maxCorner) {
+	Q_ASSERT(contains(boxId));
+	Node & n = m_nodes[m_leafNodes[boxId]];
+	n.m_min = minCorner;
+	n.m_max = maxCorner;
+	refit(n.m_parent);
+}
+
+
+void BoxBVH::renameBox(unsigned int oldBoxId, unsigned int newBoxId) {
+	Q_ASSERT(contains(oldBoxId) && !contains(newBoxId));
+	int leaf = m_leafNodes[oldBoxId];
+	m_leafNodes[oldBoxId] = -1;
+	if (m_leafNodes.size() <= newBoxId)
+		m_leafNodes.resize(newBoxId + 1, -1);
+	m_leafNodes[newBoxId] = leaf;
+	m_nodes[leaf].m_boxId = (int)newBoxId;
+}
+
+
+bool BoxBVH::intersects(const Node & n, const QVector3D & p1, const QVector3D & invD, float tMax, float & tEnter) {
+	// slab test: intersect line with the three pairs of planes and keep the overlapping interval
+	float t1 = (n.m_min.x() - p1.x())*invD.x();
+	float t2 = (n.m_max.x() - p1.x())*invD.x();
+	float tmin = std::min(t1, t2);
+	float tmax = std::max(t1, t2);
+
+	t1 = (n.m_min.y() - p1.y())*invD.y();
+	t2 = (n.m_max.y() - p1.y())*invD.y();
+	tmin = std::max(tmin, std::min(t1, t2));
+	tmax = std::min(tmax, std::max(t1, t2));
+
+	t1 = (n.m_min.z() - p1.z())*invD.z();
+	t2 = (n.m_max.z() - p1.z())*invD.z();
+	tmin = std::max(tmin, std::min(t1, t2));
+	tmax = std::min(tmax, std::max(t1, t2));
+
+	// clip to line segment
+	tmin = std::max(tmin, 0.f);
+	tmax = std::min(tmax, tMax);
+
+	tEnter = tmin;
+	return tmin <= tmax;
+}
+
+
+int BoxBVH::buildRecursive(unsigned int first, unsigned int last, int parent,
+						   const std::vector<QVector3D> & minCorners, const std::vector<QVector3D> & maxCorners)
+{
+	int nodeIdx = (int)m_nodes.size();
+	m_nodes.push_back(Node());
+
+	// compute node bounds and bounds of box centers
+	QVector3D nmin = minCorners[m_boxIds[first]];
+	QVector3D nmax = maxCorners[m_boxIds[first]];
+	QVector3D cmin = 0.5f*(nmin + nmax);
+	QVector3D cmax = cmin;
+	for (unsigned int i=first+1; i<last; ++i) {
+		const QVector3D & bmin = minCorners[m_boxIds[i]];
+		const QVector3D & bmax = maxCorners[m_boxIds[i]];
+		QVector3D c = 0.5f*(bmin + bmax);
+		for (int j=0; j<3; ++j) {
+			nmin[j] = std::min(nmin[j], bmin[j]);
+			nmax[j] = std::max(nmax[j], bmax[j]);
+			cmin[j] = std::min(cmin[j], c[j]);
+			cmax[j] = std::max(cmax[j], c[j]);
+		}
+	}
+	m_nodes[nodeIdx].m_min = nmin;
+	m_nodes[nodeIdx].m_max = nmax;
+	m_nodes[nodeIdx].m_parent = parent;
+
+	// leaf node?
+	if (last - first == 1) {
+		m_nodes[nodeIdx].m_left = -1;
+		m_nodes[nodeIdx].m_right = -1;
+		m_nodes[nodeIdx].m_boxId = m_boxIds[first];
+		m_leafNodes[m_boxIds[first]] = nodeIdx;
+		return nodeIdx;
+	}
+	m_innerArea += area(nmin, nmax);
+
+	// split along the longest axis of the box centers at the median
+	QVector3D extent = cmax - cmin;
+	int axis = 0;
+	if (extent.y() > extent[axis]) axis = 1;
+	if (extent.z() > extent[axis]) axis = 2;
+
+	unsigned int mid = (first + last)/2;
+	std::nth_element(m_boxIds.begin() + first, m_boxIds.begin() + mid, m_boxIds.begin() + last,
+		[&minCorners, &maxCorners, axis](int a, int b) {
+			return minCorners[a][axis] + maxCorners[a][axis] < minCorners[b][axis] + maxCorners[b][axis];
+		});
+
+	// mind: m_nodes may be reallocated in the recursive calls, so do not hold references to nodes here
+	int left = buildRecursive(first, mid, nodeIdx, minCorners, maxCorners);
+	int right = buildRecursive(mid, last, nodeIdx, minCorners, maxCorners);
+	m_nodes[nodeIdx].m_left = left;
+	m_nodes[nodeIdx].m_right = right;
+	m_nodes[nodeIdx].m_boxId = -1;
+	return nodeIdx;
+}
+
+
+int BoxBVH::allocateNode() {
+	if (!m_freeNodes.empty()) {
+		int nodeIdx = m_freeNodes.back();
+		m_freeNodes.pop_back();
+		return nodeIdx;
+	}
+	m_nodes.push_back(Node());
+	return (int)m_nodes.size() - 1;
+}
+
+
+void BoxBVH::replaceChild(int parent, int oldChild, int newChild) {
+	if (parent == -1) {
+		m_root = newChild;
+		return;
+	}
+	if (m_nodes[parent].m_left == oldChild)
+		m_nodes[parent].m_left = newChild;
+	else
+		m_nodes[parent].m_right = newChild;
+}
+
+
+void BoxBVH::refit(int nodeIdx) {
+	while (nodeIdx != -1) {
+		Node & n = m_nodes[nodeIdx];
+		const Node & l = m_nodes[n.m_left];
+		const Node & r = m_nodes[n.m_right];
+		QVector3D nmin, nmax;
+		for (int j=0; j<3; ++j) {
+			nmin[j] = std::min(l.m_min[j], r.m_min[j]);
+			nmax[j] = std::max(l.m_max[j], r.m_max[j]);
+		}
+		// bounding box unchanged - parent nodes are unchanged as well
+		if (nmin == n.m_min && nmax == n.m_max)
+			return;
+		m_innerArea += area(nmin, nmax) - area(n.m_min, n.m_max);
+		n.m_min = nmin;
+		n.m_max = nmax;
+		nodeIdx = n.m_parent;
+	}
+}
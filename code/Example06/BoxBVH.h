@@ -0,0 +1,180 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef BOXBVH_H
+#define BOXBVH_H
+
+#include <QVector3D>
+#include <vector>
+
+/*! A bounding volume hierarchy (binary tree of axis-aligned bounding boxes) over the boxes
+	of a BoxObject.
+
+	The tree is built top-down by splitting the box centers at the median along the longest
+	axis. Each leaf node references exactly one box. Picking traverses the tree front-to-back
+	and skips all nodes that are further away than the closest hit found so far.
+
+	Individual boxes can be inserted, removed and updated afterwards. These operations only
+	refit the bounding boxes of the nodes on the path to the root (O(log n) for a balanced tree).
+	Since the tree quality degrades with such modifications, degradation() reports the
+	ratio of the current and the initial surface area of all inner nodes (surface area
+	heuristic). When it gets too large, the tree should be rebuilt.
+*/
+class BoxBVH {
+public:
+	/*! A tree node. For leaf nodes, m_boxId holds the index of the referenced box and
+		m_left/m_right are -1. For inner nodes, m_boxId is -1. m_parent is -1 for the root node.
+	*/
+	struct Node {
+		QVector3D	m_min;
+		QVector3D	m_max;
+		int			m_parent;
+		int			m_left;
+		int			m_right;
+		int			m_boxId;
+	};
+
+	/*! Builds the tree from the bounding boxes of all boxes (minimum and maximum corners, box index
+		is the vector index).
+	*/
+	void build(const std::vector<QVector3D> & minCorners, const std::vector<QVector3D> & maxCorners);
+
+	/*! Removes all nodes. */
+	void clear();
+
+	/*! Adds box with index boxId and the given bounding box. The box is inserted next to the leaf node,
+		whose bounding box grows least (in terms of surface area).
+	*/
+	void insert(unsigned int boxId, const QVector3D & minCorner, const QVector3D & maxCorner);
+	/*! Removes box with index boxId from the tree. */
+	void remove(unsigned int boxId);
+	/*! Updates the bounding box of box with index boxId (e.g. after the box was moved) and refits all parent nodes. */
+	void update(unsigned int boxId, const QVector3D & minCorner, const QVector3D & maxCorner);
+	/*! Changes the index of a box in the tree from oldBoxId to newBoxId (newBoxId must not be in the tree). */
+	void renameBox(unsigned int oldBoxId, unsigned int newBoxId);
+
+	/*! Returns true, if box with index boxId is stored in the tree. */
+	bool contains(unsigned int boxId) const { return boxId < m_leafNodes.size() && m_leafNodes[boxId] != -1; }
+
+	/*! Ratio of the surface area of all inner nodes to the same value directly after build().
+		Values larger than 1 indicate, that picking through the tree has become more expensive.
+	*/
+	float degradation() const { return m_builtInnerArea > 0 ? float(m_innerArea/m_builtInnerArea) : 1.f; }
+
+	/*! Visits all boxes whose bounding boxes are hit by the line "p1 + d [0..tMax]", nearest nodes first.
+
+		For each candidate box, the callback test(boxId, tMax) is called. It is expected to check the
+		actual box geometry and to reduce tMax to the distance of a confirmed hit. All nodes
+		further away than tMax are skipped afterwards.
+	*/
+	template <typename BoxTest>
+	void traverse(const QVector3D & p1, const QVector3D & d, float tMax, BoxTest test) const;
+
+	/*! Tests if line "p1 + d [0..tMax]" hits the node's bounding box. invD holds the componentwise
+		inverse of the line direction. Returns the distance where the line enters the box in tEnter.
+	*/
+	static bool intersects(const Node & n, const QVector3D & p1, const QVector3D & invD, float tMax, float & tEnter);
+
+	/*! All nodes, including unused nodes (see m_freeNodes). */
+	std::vector<Node>	m_nodes;
+	/*! Index of root node, -1 if tree is empty. */
+	int					m_root = -1;
+	/*! Index of leaf node for each box, -1 for boxes not in the tree. */
+	std::vector<int>	m_leafNodes;
+
+private:
+	/*! Recursively creates the sub-tree for boxes in m_boxIds[first..last) and returns the index of its root node. */
+	int buildRecursive(unsigned int first, unsigned int last, int parent,
+					   const std::vector<QVector3D> & minCorners, const std::vector<QVector3D> & maxCorners);
+
+	/*! Returns index of an unused node, either from m_freeNodes or newly appended. */
+	int allocateNode();
+	/*! Replaces child oldChild of node parent by newChild, or sets newChild as root node if parent is -1. */
+	void replaceChild(int parent, int oldChild, int newChild);
+	/*! Recomputes bounding boxes of the node and all its parents from their children.
+		Stops at the first node whose bounding box does not change.
+	*/
+	void refit(int nodeIdx);
+
+	/*! Surface area of a bounding box (without factor 2). */
+	static float area(const QVector3D & minCorner, const QVector3D & maxCorner) {
+		QVector3D e = maxCorner - minCorner;
+		return e.x()*e.y() + e.y()*e.z() + e.z()*e.x();
+	}
+
+	/*! Box indexes, sorted during build. */
+	std::vector<int>	m_boxIds;
+	/*! Indexes of unused nodes (of removed boxes), reused in insert(). */
+	std::vector<int>	m_freeNodes;
+	/*! Sum of surface areas of all inner nodes. */
+	double				m_innerArea = 0;
+	/*! m_innerArea after build(). */
+	double				m_builtInnerArea = 0;
+};
+
+
+template <typename BoxTest>
+void BoxBVH::traverse(const QVector3D & p1, const QVector3D & d, float tMax, BoxTest test) const {
+	if (m_root == -1)
+		return;
+
+	// inverse direction, division by zero yields +/- inf, which is handled correctly by the slab test
+	QVector3D invD(1.f/d.x(), 1.f/d.y(), 1.f/d.z());
+
+	float tEnter;
+	if (!intersects(m_nodes[m_root], p1, invD, tMax, tEnter))
+		return;
+
+	// stack with nodes to process, and the distance at which the line enters the node's bounding box
+	// (after insertions, the tree may be deeper than a tree just built, hence a growing stack)
+	struct StackEntry {
+		int		m_nodeIdx;
+		float	m_tEnter;
+	};
+	std::vector<StackEntry> stack;
+	stack.reserve(64);
+	stack.push_back(StackEntry{m_root, tEnter});
+
+	while (!stack.empty()) {
+		StackEntry e = stack.back();
+		stack.pop_back();
+		// a closer hit was found meanwhile, skip node
+		if (e.m_tEnter > tMax)
+			continue;
+
+		const Node & n = m_nodes[e.m_nodeIdx];
+		if (n.m_boxId != -1) {
+			test((unsigned int)n.m_boxId, tMax);
+			continue;
+		}
+
+		float tLeft, tRight;
+		bool hitLeft = intersects(m_nodes[n.m_left], p1, invD, tMax, tLeft);
+		bool hitRight = intersects(m_nodes[n.m_right], p1, invD, tMax, tRight);
+		// push the farther node first, so that the closer node is processed next
+		if (hitLeft && hitRight) {
+			if (tLeft < tRight) {
+				stack.push_back(StackEntry{n.m_right, tRight});
+				stack.push_back(StackEntry{n.m_left, tLeft});
+			}
+			else {
+				stack.push_back(StackEntry{n.m_left, tLeft});
+				stack.push_back(StackEntry{n.m_right, tRight});
+			}
+		}
+		else if (hitLeft)
+			stack.push_back(StackEntry{n.m_left, tLeft});
+		else if (hitRight)
+			stack.push_back(StackEntry{n.m_right, tRight});
+	}
+}
+
+#endif // BOXBVH_H
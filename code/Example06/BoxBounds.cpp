@@ -0,0 +1,239 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "BoxBounds.h"
+
+#include <algorithm>
+
+#include "Frustum.h"
+
+// Vector width and intrinsics used by the vectorized kernels below
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define BOXBOUNDS_AVX
+	#define BOXBOUNDS_SIMD
+	static const unsigned int W = 8; // boxes per vector
+	typedef __m256 vec;
+	#define VSET1		_mm256_set1_ps
+	#define VLOAD		_mm256_loadu_ps
+	#define VSTORE		_mm256_storeu_ps
+	#define VADD		_mm256_add_ps
+	#define VSUB		_mm256_sub_ps
+	#define VMUL		_mm256_mul_ps
+	#define VMIN		_mm256_min_ps
+	#define VMAX		_mm256_max_ps
+	#define VLE(a,b)	_mm256_cmp_ps(a, b, _CMP_LE_OQ)
+	#define VLT(a,b)	_mm256_cmp_ps(a, b, _CMP_LT_OQ)
+	#define VAND		_mm256_and_ps
+	#define VSELECT(mask, a, b)	_mm256_blendv_ps(b, a, mask) // a where mask is set, b otherwise
+	#define VMOVEMASK	_mm256_movemask_ps
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define BOXBOUNDS_SSE
+	#define BOXBOUNDS_SIMD
+	static const unsigned int W = 4; // boxes per vector
+	typedef __m128 vec;
+	#define VSET1		_mm_set1_ps
+	#define VLOAD		_mm_loadu_ps
+	#define VSTORE		_mm_storeu_ps
+	#define VADD		_mm_add_ps
+	#define VSUB		_mm_sub_ps
+	#define VMUL		_mm_mul_ps
+	#define VMIN		_mm_min_ps
+	#define VMAX		_mm_max_ps
+	#define VLE(a,b)	_mm_cmple_ps(a, b)
+	#define VLT(a,b)	_mm_cmplt_ps(a, b)
+	#define VAND		_mm_and_ps
+	#define VSELECT(mask, a, b)	_mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b))
+	#define VMOVEMASK	_mm_movemask_ps
+#endif
+
+void BoxBounds::resize(unsigned int n) {
+	m_minX.resize(n);
+	m_minY.resize(n);
+	m_minZ.resize(n);
+	m_maxX.resize(n);
+	m_maxY.resize(n);
+	m_maxZ.resize(n);
+}
+
+
+/*! Scalar slab test for boxes first...last-1. Updates tBest and returns the index of the closest box
+	(entered before tBest), or -1 if none of the boxes in the range is closer.
+*/
+static int slabHitRange(const BoxBounds & b, unsigned int first, unsigned int last,
+						const QVector3D & p1, const QVector3D & invD, float & tBest)
+{
+	int idx = -1;
+	for (unsigned int i=first; i<last; ++i) {
+		float t1 = (b.m_minX[i] - p1.x())*invD.x();
+		float t2 = (b.m_maxX[i] - p1.x())*invD.x();
+		float tmin = std::min(t1, t2);
+		float tmax = std::max(t1, t2);
+
+		t1 = (b.m_minY[i] - p1.y())*invD.y();
+		t2 = (b.m_maxY[i] - p1.y())*invD.y();
+		tmin = std::max(tmin, std::min(t1, t2));
+		tmax = std::min(tmax, std::max(t1, t2));
+
+		t1 = (b.m_minZ[i] - p1.z())*invD.z();
+		t2 = (b.m_maxZ[i] - p1.z())*invD.z();
+		tmin = std::max(tmin, std::min(t1, t2));
+		tmax = std::min(tmax, std::max(t1, t2));
+
+		tmin = std::max(tmin, 0.f);
+		tmax = std::min(tmax, tBest);
+		if (tmin <= tmax && tmin < tBest) {
+			tBest = tmin;
+			idx = (int)i;
+		}
+	}
+	return idx;
+}
+
+
+int nearestSlabHitScalar(const BoxBounds & bounds, const QVector3D & p1, const QVector3D & d, float tMax, float & tEnter) {
+	QVector3D invD(1.f/d.x(), 1.f/d.y(), 1.f/d.z());
+	tEnter = tMax;
+	return slabHitRange(bounds, 0, bounds.size(), p1, invD, tEnter);
+}
+
+
+int nearestSlabHit(const BoxBounds & bounds, const QVector3D & p1, const QVector3D & d, float tMax, float & tEnter) {
+#if defined(BOXBOUNDS_SIMD)
+	QVector3D invD(1.f/d.x(), 1.f/d.y(), 1.f/d.z());
+	const unsigned int n = bounds.size();
+	Q_ASSERT(n < (1u << 24)); // indexes must be representable as float
+
+#if defined(BOXBOUNDS_AVX)
+	vec laneIdx = _mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0);
+#else
+	vec laneIdx = _mm_set_ps(3, 2, 1, 0);
+#endif
+
+	const vec px = VSET1(p1.x());
+	const vec py = VSET1(p1.y());
+	const vec pz = VSET1(p1.z());
+	const vec ix = VSET1(invD.x());
+	const vec iy = VSET1(invD.y());
+	const vec iz = VSET1(invD.z());
+	const vec zero = VSET1(0.f);
+	const vec step = VSET1(float(W));
+	// closest entry distance and corresponding box index per lane
+	vec bestT = VSET1(tMax);
+	vec bestIdx = VSET1(-1.f);
+
+	const unsigned int nVec = n - n % W;
+	for (unsigned int i=0; i<nVec; i+=W) {
+		vec t1 = VMUL(VSUB(VLOAD(&bounds.m_minX[i]), px), ix);
+		vec t2 = VMUL(VSUB(VLOAD(&bounds.m_maxX[i]), px), ix);
+		vec tmin = VMIN(t1, t2);
+		vec tmax = VMAX(t1, t2);
+
+		t1 = VMUL(VSUB(VLOAD(&bounds.m_minY[i]), py), iy);
+		t2 = VMUL(VSUB(VLOAD(&bounds.m_maxY[i]), py), iy);
+		tmin = VMAX(tmin, VMIN(t1, t2));
+		tmax = VMIN(tmax, VMAX(t1, t2));
+
+		t1 = VMUL(VSUB(VLOAD(&bounds.m_minZ[i]), pz), iz);
+		t2 = VMUL(VSUB(VLOAD(&bounds.m_maxZ[i]), pz), iz);
+		tmin = VMAX(tmin, VMIN(t1, t2));
+		tmax = VMIN(tmax, VMAX(t1, t2));
+
+		tmin = VMAX(tmin, zero);
+		tmax = VMIN(tmax, bestT);
+		// hit, if slab interval is not empty and box is entered before the closest box so far (in this lane)
+		vec hit = VAND(VLE(tmin, tmax), VLT(tmin, bestT));
+		bestT = VSELECT(hit, tmin, bestT);
+		bestIdx = VSELECT(hit, laneIdx, bestIdx);
+		laneIdx = VADD(laneIdx, step);
+	}
+
+	// reduce lanes, on equal distances prefer the smaller box index (same result as the scalar version)
+	float laneT[W];
+	float laneBoxIdx[W];
+	VSTORE(laneT, bestT);
+	VSTORE(laneBoxIdx, bestIdx);
+
+	int idx = -1;
+	tEnter = tMax;
+	for (unsigned int j=0; j<W; ++j) {
+		if (laneBoxIdx[j] < 0)
+			continue;
+		if (laneT[j] < tEnter || (laneT[j] == tEnter && (int)laneBoxIdx[j] < idx)) {
+			tEnter = laneT[j];
+			idx = (int)laneBoxIdx[j];
+		}
+	}
+
+	// remaining boxes
+	int tailIdx = slabHitRange(bounds, nVec, n, p1, invD, tEnter);
+	if (tailIdx != -1)
+		idx = tailIdx;
+	return idx;
+#else
+	return nearestSlabHitScalar(bounds, p1, d, tMax, tEnter);
+#endif
+}
+
+
+void boxesInFrustum(const BoxBounds & bounds, const Frustum & frustum, std::vector<unsigned int> & boxIds) {
+	boxIds.clear();
+	const unsigned int n = bounds.size();
+
+	// The plane normals are the same for all boxes, so we can select the box corner farthest along
+	// each plane normal (coordinate arrays) once. If this corner is outside, the entire box is outside.
+	const float * cx[Frustum::NUM_P];
+	const float * cy[Frustum::NUM_P];
+	const float * cz[Frustum::NUM_P];
+	for (int p=0; p<Frustum::NUM_P; ++p) {
+		const QVector4D & pl = frustum.m_planes[p];
+		cx[p] = pl.x() >= 0 ? bounds.m_maxX.data() : bounds.m_minX.data();
+		cy[p] = pl.y() >= 0 ? bounds.m_maxY.data() : bounds.m_minY.data();
+		cz[p] = pl.z() >= 0 ? bounds.m_maxZ.data() : bounds.m_minZ.data();
+	}
+
+	unsigned int i = 0;
+#if defined(BOXBOUNDS_SIMD)
+	vec a[Frustum::NUM_P], b[Frustum::NUM_P], c[Frustum::NUM_P], d[Frustum::NUM_P];
+	for (int p=0; p<Frustum::NUM_P; ++p) {
+		a[p] = VSET1(frustum.m_planes[p].x());
+		b[p] = VSET1(frustum.m_planes[p].y());
+		c[p] = VSET1(frustum.m_planes[p].z());
+		d[p] = VSET1(frustum.m_planes[p].w());
+	}
+	const vec zero = VSET1(0.f);
+	const unsigned int nVec = n - n % W;
+	for (; i<nVec; i+=W) {
+		vec inside = VLE(zero, zero); // all bits set
+		for (int p=0; p<Frustum::NUM_P; ++p) {
+			vec dist = VADD(VADD(VMUL(VLOAD(cx[p] + i), a[p]), VMUL(VLOAD(cy[p] + i), b[p])),
+							VADD(VMUL(VLOAD(cz[p] + i), c[p]), d[p]));
+			inside = VAND(inside, VLE(zero, dist));
+		}
+		int mask = VMOVEMASK(inside);
+		for (unsigned int j=0; mask != 0; ++j, mask >>= 1)
+			if (mask & 1)
+				boxIds.push_back(i + j);
+	}
+#endif
+
+	// remaining boxes
+	for (; i<n; ++i) {
+		bool inside = true;
+		for (int p=0; p<Frustum::NUM_P && inside; ++p) {
+			const QVector4D & pl = frustum.m_planes[p];
+			inside = (cx[p][i]*pl.x() + cy[p][i]*pl.y()) + (cz[p][i]*pl.z() + pl.w()) >= 0;
+		}
+		if (inside)
+			boxIds.push_back(i);
+	}
+}
@@ -0,0 +1,66 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef BOXBOUNDS_H
+#define BOXBOUNDS_H
+
+#include <QVector3D>
+#include <vector>
+
+class Frustum;
+
+/*! Axis-aligned bounding boxes of many boxes, stored as structure of arrays (one array per
+	coordinate), so that the slab test can process 4 (SSE) or 8 (AVX) boxes at once.
+*/
+struct BoxBounds {
+	/*! Resizes all arrays to hold n boxes. */
+	void resize(unsigned int n);
+	/*! Stores the bounding box of box with index i. */
+	void set(unsigned int i, const QVector3D & minCorner, const QVector3D & maxCorner) {
+		m_minX[i] = minCorner.x();
+		m_minY[i] = minCorner.y();
+		m_minZ[i] = minCorner.z();
+		m_maxX[i] = maxCorner.x();
+		m_maxY[i] = maxCorner.y();
+		m_maxZ[i] = maxCorner.z();
+	}
+	unsigned int size() const { return m_minX.size(); }
+
+	std::vector<float>	m_minX;
+	std::vector<float>	m_minY;
+	std::vector<float>	m_minZ;
+	std::vector<float>	m_maxX;
+	std::vector<float>	m_maxY;
+	std::vector<float>	m_maxZ;
+};
+
+
+/*! Finds the box whose bounding box is entered first by the line "p1 + d [0..tMax]".
+	Returns the index of the box, or -1 if no box is hit. The distance at which the line enters
+	the bounding box is returned in tEnter.
+
+	Uses AVX (8 boxes per instruction) if compiled with AVX support, SSE (4 boxes per instruction)
+	on other x86 platforms and nearestSlabHitScalar() otherwise.
+
+	Mind: box indexes are tracked as float values in the vectorized versions, so this
+	works for up to 2^24 boxes.
+*/
+int nearestSlabHit(const BoxBounds & bounds, const QVector3D & p1, const QVector3D & d, float tMax, float & tEnter);
+
+/*! Same as nearestSlabHit(), but processes one box at a time. */
+int nearestSlabHitScalar(const BoxBounds & bounds, const QVector3D & p1, const QVector3D & d, float tMax, float & tEnter);
+
+/*! Collects the indexes of all boxes whose bounding boxes are at least partially inside the frustum.
+	Processes 4 (SSE) or 8 (AVX) boxes at once, like nearestSlabHit().
+*/
+void boxesInFrustum(const BoxBounds & bounds, const Frustum & frustum, std::vector<unsigned int> & boxIds);
+
+#endif // BOXBOUNDS_H
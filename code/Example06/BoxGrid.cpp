@@ -0,0 +1,76 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "BoxGrid.h"
+
+void BoxGrid::setup(const QVector3D & origin, const QVector3D & cellSize, unsigned int nx, unsigned int ny, unsigned int nz) {
+	m_origin = origin;
+	m_cellSize = cellSize;
+	m_dim[0] = nx;
+	m_dim[1] = ny;
+	m_dim[2] = nz;
+	m_cells.clear();
+	m_cells.resize(nx*ny*nz);
+	m_unalignedBoxIds.clear();
+}
+
+
+void BoxGrid::insert(unsigned int boxId, const QVector3D & minCorner, const QVector3D & maxCorner) {
+	int cmin[3], cmax[3];
+	if (!cellRange(minCorner, maxCorner, cmin, cmax)) {
+		m_unalignedBoxIds.push_back(boxId);
+		return;
+	}
+
+	for (int k=cmin[2]; k<=cmax[2]; ++k)
+		for (int j=cmin[1]; j<=cmax[1]; ++j)
+			for (int i=cmin[0]; i<=cmax[0]; ++i)
+				m_cells[cellIndex(i, j, k)].push_back(boxId);
+}
+
+
+/*! Removes the first occurrence of boxId from the vector. */
+static void eraseBoxId(std::vector<unsigned int> & boxIds, unsigned int boxId) {
+	std::vector<unsigned int>::iterator it = std::find(boxIds.begin(), boxIds.end(), boxId);
+	if (it != boxIds.end())
+		boxIds.erase(it);
+}
+
+
+void BoxGrid::remove(unsigned int boxId, const QVector3D & minCorner, const QVector3D & maxCorner) {
+	int cmin[3], cmax[3];
+	if (!cellRange(minCorner, maxCorner, cmin, cmax)) {
+		eraseBoxId(m_unalignedBoxIds, boxId);
+		return;
+	}
+
+	for (int k=cmin[2]; k<=cmax[2]; ++k)
+		for (int j=cmin[1]; j<=cmax[1]; ++j)
+			for (int i=cmin[0]; i<=cmax[0]; ++i)
+				eraseBoxId(m_cells[cellIndex(i, j, k)], boxId);
+}
+
+
+bool BoxGrid::cellRange(const QVector3D & minCorner, const QVector3D & maxCorner, int cmin[3], int cmax[3]) const {
+	for (int j=0; j<3; ++j) {
+		cmin[j] = (int)std::floor((minCorner[j] - m_origin[j])/m_cellSize[j]);
+		cmax[j] = (int)std::floor((maxCorner[j] - m_origin[j])/m_cellSize[j]);
+		// a box touching the upper lattice boundary is still inside
+		if (cmax[j] == (int)m_dim[j] && minCorner[j] < maxCorner[j] &&
+			maxCorner[j] == m_origin[j] + m_dim[j]*m_cellSize[j])
+		{
+			--cmax[j];
+		}
+		if (cmin[j] < 0 || cmax[j] >= (int)m_dim[j])
+			return false;
+	}
+	return true;
+}
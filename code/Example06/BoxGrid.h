@@ -0,0 +1,159 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef BOXGRID_H
+#define BOXGRID_H
+
+#include <QVector3D>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/*! A uniform spatial grid (lattice of equally sized cells) with lists of box indexes per cell.
+
+	Boxes are registered in all cells they overlap. Boxes that are not completely inside the
+	lattice are kept in a separate list and are always tested.
+
+	Picking walks along the pick line through the cells (3D digital differential analyzer, i.e.
+	we always step into the neighboring cell whose boundary is crossed next) and stops in the
+	first cell with a confirmed hit.
+*/
+class BoxGrid {
+public:
+	/*! Initializes an empty lattice.
+		\param origin Minimum corner of cell (0,0,0).
+		\param cellSize Dimensions of a cell.
+		\param nx, ny, nz Number of cells in each direction.
+	*/
+	void setup(const QVector3D & origin, const QVector3D & cellSize, unsigned int nx, unsigned int ny, unsigned int nz);
+
+	/*! Registers the box with index boxId and the given bounding box (minimum and maximum corner). */
+	void insert(unsigned int boxId, const QVector3D & minCorner, const QVector3D & maxCorner);
+
+	/*! Removes the box with index boxId, minCorner and maxCorner must be the bounding box used in insert(). */
+	void remove(unsigned int boxId, const QVector3D & minCorner, const QVector3D & maxCorner);
+
+	/*! Visits all boxes in cells crossed by the line "p1 + d [0..tMax]", nearest cells first.
+
+		For each candidate box, the callback test(boxId, tMax) is called. It is expected to check the
+		actual box geometry and to reduce tMax to the distance of a confirmed hit. The walk
+		stops once a hit lies within the current cell.
+	*/
+	template <typename BoxTest>
+	void traverse(const QVector3D & p1, const QVector3D & d, float tMax, BoxTest test) const;
+
+	/*! Returns the linear cell index for cell (i,j,k). */
+	unsigned int cellIndex(unsigned int i, unsigned int j, unsigned int k) const {
+		return (k*m_dim[1] + j)*m_dim[0] + i;
+	}
+
+	/*! Minimum corner of cell (0,0,0). */
+	QVector3D			m_origin;
+	/*! Cell dimensions. */
+	QVector3D			m_cellSize;
+	/*! Number of cells in x, y and z direction. */
+	unsigned int		m_dim[3];
+
+	/*! Box indexes per cell, use cellIndex() to access cells. */
+	std::vector< std::vector<unsigned int> >	m_cells;
+	/*! Boxes outside or partially outside the lattice. */
+	std::vector<unsigned int>					m_unalignedBoxIds;
+
+private:
+	/*! Determines the range of cells cmin...cmax overlapped by the bounding box. Returns false,
+		if the box is not completely inside the lattice.
+	*/
+	bool cellRange(const QVector3D & minCorner, const QVector3D & maxCorner, int cmin[3], int cmax[3]) const;
+};
+
+
+template <typename BoxTest>
+void BoxGrid::traverse(const QVector3D & p1, const QVector3D & d, float tMax, BoxTest test) const {
+	// boxes outside the lattice are always tested first, they may reduce tMax
+	for (unsigned int boxId : m_unalignedBoxIds)
+		test(boxId, tMax);
+
+	if (m_cells.empty())
+		return;
+
+	// clip line to lattice bounds (slab test), t0 and t1 are the distances where the line enters and leaves the lattice
+	float t0 = 0;
+	float t1 = tMax;
+	for (int j=0; j<3; ++j) {
+		float lower = m_origin[j];
+		float upper = m_origin[j] + m_dim[j]*m_cellSize[j];
+		if (d[j] == 0.f) {
+			if (p1[j] < lower || p1[j] > upper)
+				return;
+			continue;
+		}
+		float ta = (lower - p1[j])/d[j];
+		float tb = (upper - p1[j])/d[j];
+		if (ta > tb)
+			std::swap(ta, tb);
+		t0 = std::max(t0, ta);
+		t1 = std::min(t1, tb);
+	}
+	if (t0 > t1)
+		return;
+
+	// determine start cell and set up stepping information per direction
+	QVector3D entryPoint = p1 + t0*d;
+	int cell[3];
+	int step[3];
+	float tNext[3];		// distance at which the line crosses the next cell boundary
+	float tDelta[3];	// distance between two cell boundary crossings
+	for (int j=0; j<3; ++j) {
+		cell[j] = (int)std::floor((entryPoint[j] - m_origin[j])/m_cellSize[j]);
+		cell[j] = std::max(0, std::min((int)m_dim[j]-1, cell[j]));
+		if (d[j] > 0) {
+			step[j] = 1;
+			tNext[j] = (m_origin[j] + (cell[j]+1)*m_cellSize[j] - p1[j])/d[j];
+			tDelta[j] = m_cellSize[j]/d[j];
+		}
+		else if (d[j] < 0) {
+			step[j] = -1;
+			tNext[j] = (m_origin[j] + cell[j]*m_cellSize[j] - p1[j])/d[j];
+			tDelta[j] = -m_cellSize[j]/d[j];
+		}
+		else {
+			step[j] = 0;
+			tNext[j] = std::numeric_limits<float>::max();
+			tDelta[j] = std::numeric_limits<float>::max();
+		}
+	}
+
+	float tCellEnter = t0;
+	while (tCellEnter <= tMax && tCellEnter <= t1) {
+		// axis, whose cell boundary is crossed next
+		int axis = 0;
+		if (tNext[1] < tNext[axis]) axis = 1;
+		if (tNext[2] < tNext[axis]) axis = 2;
+		float tCellExit = tNext[axis];
+
+		for (unsigned int boxId : m_cells[cellIndex(cell[0], cell[1], cell[2])])
+			test(boxId, tMax);
+
+		// a hit within the current cell cannot be occluded by boxes in the cells further along the line
+		if (tMax <= tCellExit)
+			return;
+
+		// step into next cell
+		cell[axis] += step[axis];
+		if (cell[axis] < 0 || cell[axis] >= (int)m_dim[axis])
+			return;
+		tCellEnter = tCellExit;
+		tNext[axis] += tDelta[axis];
+	}
+}
+
+#endif // BOXGRID_H
@@ -0,0 +1,554 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "BoxImporter.h"
+
+#include <QFileInfo>
+#include <QThreadPool>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "Parallel.h"
+
+/*! Maximum number of chunks parsed ahead of takeBoxes(), per thread pool thread. */
+static const unsigned int MaxChunksAheadPerThread = 2;
+
+
+// *** Parser helper functions ***
+
+// All functions take the current position p, which is advanced past the parsed input, and the end
+// of the mapped file. Mind: the mapped file is not null-terminated, so we must not use strtod() and the like.
+
+static inline bool isBlank(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline void skipBlanks(const char *& p, const char * end) {
+	while (p < end && isBlank(*p))
+		++p;
+}
+
+static inline void skipWhitespace(const char *& p, const char * end) {
+	while (p < end && (isBlank(*p) || *p == '\n'))
+		++p;
+}
+
+/*! Advances p to the start of the next line. */
+static inline void skipLine(const char *& p, const char * end) {
+	while (p < end && *p != '\n')
+		++p;
+	if (p < end)
+		++p;
+}
+
+/*! Parses a decimal number with optional sign, fraction and exponent. */
+static bool parseFloat(const char *& p, const char * end, float & value) {
+	static const double PowersOf10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+										1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+	const char * s = p;
+	bool negative = false;
+	if (s < end && (*s == '-' || *s == '+')) {
+		negative = (*s == '-');
+		++s;
+	}
+	// mantissa digits beyond the 18th are ignored, but count for the decimal exponent
+	quint64 mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool hasDigits = false;
+	for (; s < end && *s >= '0' && *s <= '9'; ++s) {
+		hasDigits = true;
+		if (digits < 18) {
+			mantissa = mantissa*10 + quint64(*s - '0');
+			if (mantissa != 0)
+				++digits;
+		}
+		else
+			++exponent;
+	}
+	if (s < end && *s == '.') {
+		++s;
+		for (; s < end && *s >= '0' && *s <= '9'; ++s) {
+			hasDigits = true;
+			if (digits < 18) {
+				mantissa = mantissa*10 + quint64(*s - '0');
+				if (mantissa != 0)
+					++digits;
+				--exponent;
+			}
+		}
+	}
+	if (!hasDigits)
+		return false;
+	if (s < end && (*s == 'e' || *s == 'E')) {
+		const char * e = s + 1;
+		bool negativeExp = false;
+		if (e < end && (*e == '-' || *e == '+')) {
+			negativeExp = (*e == '-');
+			++e;
+		}
+		if (e < end && *e >= '0' && *e <= '9') {
+			int exp = 0;
+			for (; e < end && *e >= '0' && *e <= '9'; ++e)
+				exp = std::min(exp*10 + (*e - '0'), 1000);
+			exponent += negativeExp ? -exp : exp;
+			s = e;
+		}
+	}
+	double v = double(mantissa);
+	if (exponent < 0)
+		v = (-exponent <= 18) ? v/PowersOf10[-exponent] : v*std::pow(10.0, exponent);
+	else if (exponent > 0)
+		v = (exponent <= 18) ? v*PowersOf10[exponent] : v*std::pow(10.0, exponent);
+	value = float(negative ? -v : v);
+	p = s;
+	return true;
+}
+
+/*! Parses a (possibly negative) integer. */
+static bool parseInt(const char *& p, const char * end, int & value) {
+	const char * s = p;
+	bool negative = false;
+	if (s < end && (*s == '-' || *s == '+')) {
+		negative = (*s == '-');
+		++s;
+	}
+	if (s == end || *s < '0' || *s > '9')
+		return false;
+	long long v = 0;
+	for (; s < end && *s >= '0' && *s <= '9'; ++s)
+		v = std::min(v*10 + (*s - '0'), 0x7FFFFFFFLL);
+	value = int(negative ? -v : v);
+	p = s;
+	return true;
+}
+
+static inline int hexDigit(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+/*! Parses a color "#rrggbb" (the '#' is optional). */
+static bool parseColor(const char *& p, const char * end, QRgb & color) {
+	const char * s = p;
+	if (s < end && *s == '#')
+		++s;
+	if (end - s < 6)
+		return false;
+	unsigned int rgb = 0;
+	for (int i=0; i<6; ++i) {
+		int d = hexDigit(s[i]);
+		if (d < 0)
+			return false;
+		rgb = (rgb << 4) | unsigned(d);
+	}
+	color = 0xFF000000u | rgb;
+	p = s + 6;
+	return true;
+}
+
+/*! Parses n numbers separated by commas and optional blanks (and line breaks, if acrossLines is true). */
+static bool parseFloatList(const char *& p, const char * end, float * values, int n, bool acrossLines) {
+	for (int i=0; i<n; ++i) {
+		if (i > 0) {
+			acrossLines ? skipWhitespace(p, end) : skipBlanks(p, end);
+			if (p == end || *p != ',')
+				return false;
+			++p;
+		}
+		acrossLines ? skipWhitespace(p, end) : skipBlanks(p, end);
+		if (!parseFloat(p, end, values[i]))
+			return false;
+	}
+	return true;
+}
+
+/*! Returns true, if the characters key...keyEnd-1 equal name. */
+static inline bool isKey(const char * key, const char * keyEnd, const char * name) {
+	size_t len = std::strlen(name);
+	return size_t(keyEnd - key) == len && std::memcmp(key, name, len) == 0;
+}
+
+/*! Appends an axis-aligned box with the given center, dimensions and color to boxes. */
+static void addBox(const float center[3], const float size[3], QRgb color, BoxStore & boxes) {
+	QVector3D vertices[8];
+	BoxMesh::boxVertices(QVector3D(center[0], center[1], center[2]), QVector3D(size[0], size[1], size[2]), vertices);
+	const QRgb faceColors[6] = {color, color, color, color, color, color};
+	boxes.push_back(vertices, faceColors);
+}
+
+
+// *** BoxImporter ***
+
+BoxImporter::BoxImporter() :
+	m_objThickness(0.2f),
+	m_defaultColor("#ffffe6"),
+	m_skippedRecords(0)
+{
+}
+
+
+BoxImporter::Format BoxImporter::formatFromFileName(const QString & fileName) {
+	QString suffix = QFileInfo(fileName).suffix().toLower();
+	if (suffix == "csv")
+		return F_CSV;
+	if (suffix == "json")
+		return F_JSON;
+	if (suffix == "obj")
+		return F_OBJ;
+	return NUM_F;
+}
+
+
+bool BoxImporter::start(const QString & fileName) {
+	cancel();
+	m_format = formatFromFileName(fileName);
+	if (m_format == NUM_F) {
+		qDebug() << "BoxImporter - unknown file format:" << fileName;
+		return false;
+	}
+	m_file.setFileName(fileName);
+	if (!m_file.open(QIODevice::ReadOnly)) {
+		qDebug() << "BoxImporter - cannot open" << fileName << ":" << m_file.errorString();
+		return false;
+	}
+	m_size = m_file.size();
+	if (m_size == 0) {
+		m_file.close();
+		return false;
+	}
+	m_data = reinterpret_cast<const char*>(m_file.map(0, m_size));
+	if (m_data == nullptr) {
+		qDebug() << "BoxImporter - cannot map" << fileName << ":" << m_file.errorString();
+		m_file.close();
+		return false;
+	}
+
+	m_chunks = std::vector<Chunk>((m_size + ChunkSize - 1)/ChunkSize);
+	m_nextChunk = 0;
+	m_nextTakenChunk = 0;
+	m_runningChunks = 0;
+	m_skippedRecords = 0;
+	m_objVertices.clear();
+	startChunks();
+	return true;
+}
+
+
+unsigned int BoxImporter::takeBoxes(BoxStore & boxes, bool wait) {
+	if (!isRunning())
+		return 0;
+	unsigned int boxCount = boxes.size();
+	QMutexLocker lock(&m_mutex);
+	if (wait) {
+		while (!m_chunks[m_nextTakenChunk].m_done)
+			m_chunkDone.wait(&m_mutex);
+	}
+	while (m_nextTakenChunk < m_chunks.size() && m_chunks[m_nextTakenChunk].m_done) {
+		Chunk & chunk = m_chunks[m_nextTakenChunk];
+		// the chunk is done, so no thread pool task accesses it anymore
+		lock.unlock();
+		if (m_format == F_OBJ)
+			createObjBoxes(chunk, boxes);
+		else
+			boxes.append(chunk.m_boxes);
+		m_skippedRecords += chunk.m_skippedRecords;
+		chunk = Chunk(); // release memory
+		chunk.m_done = true;
+		++m_nextTakenChunk;
+		lock.relock();
+	}
+	lock.unlock();
+
+	if (m_nextTakenChunk == m_chunks.size()) {
+		qDebug() << "BoxImporter -" << m_file.fileName() << "imported," << m_skippedRecords << "lines/objects skipped";
+		cancel();
+	}
+	else
+		startChunks();
+	return boxes.size() - boxCount;
+}
+
+
+void BoxImporter::cancel() {
+	if (!isRunning())
+		return;
+	// chunks not started yet are never started, since startChunks() is only called by this thread
+	{
+		QMutexLocker lock(&m_mutex);
+		while (m_runningChunks > 0)
+			m_chunkDone.wait(&m_mutex);
+	}
+	m_file.unmap(reinterpret_cast<uchar*>(const_cast<char*>(m_data)));
+	m_file.close();
+	m_data = nullptr;
+	m_chunks = std::vector<Chunk>();
+	m_objVertices = std::vector<QVector3D>();
+}
+
+
+quint64 BoxImporter::bytesTaken() const {
+	return std::min(quint64(m_nextTakenChunk)*ChunkSize, m_size);
+}
+
+
+void BoxImporter::startChunks() {
+	unsigned int maxChunksAhead = MaxChunksAheadPerThread*QThreadPool::globalInstance()->maxThreadCount();
+	while (m_nextChunk < m_chunks.size() && m_nextChunk < m_nextTakenChunk + maxChunksAhead) {
+		unsigned int chunkId = m_nextChunk++;
+		{
+			QMutexLocker lock(&m_mutex);
+			++m_runningChunks;
+		}
+		QThreadPool::globalInstance()->start(createRunnable([this, chunkId]() {
+			parseChunk(chunkId);
+		}));
+	}
+}
+
+
+void BoxImporter::parseChunk(unsigned int chunkId) {
+	Chunk & chunk = m_chunks[chunkId];
+	const char * chunkBegin = m_data + quint64(chunkId)*ChunkSize;
+	const char * chunkEnd = m_data + std::min(quint64(chunkId + 1)*ChunkSize, m_size);
+	switch (m_format) {
+		case F_CSV	: parseCSV(chunkBegin, chunkEnd, chunk); break;
+		case F_JSON	: parseJSON(chunkBegin, chunkEnd, chunk); break;
+		case F_OBJ	: parseOBJ(chunkBegin, chunkEnd, chunk); break;
+		case NUM_F	: break;
+	}
+
+	QMutexLocker lock(&m_mutex);
+	chunk.m_done = true;
+	--m_runningChunks;
+	m_chunkDone.wakeAll();
+}
+
+
+void BoxImporter::parseCSV(const char * p, const char * chunkEnd, Chunk & chunk) const {
+	const char * end = m_data + m_size;
+	// skip the rest of the line started in the previous chunk
+	if (p != m_data && p[-1] != '\n')
+		skipLine(p, end);
+
+	const QRgb defaultColor = m_defaultColor.rgba();
+	while (p < chunkEnd) {
+		skipBlanks(p, end);
+		if (p == end || *p == '\n' || *p == '#') {
+			skipLine(p, end);
+			continue;
+		}
+		float values[6];
+		QRgb color = defaultColor;
+		bool valid = parseFloatList(p, end, values, 6, false);
+		if (valid) {
+			skipBlanks(p, end);
+			if (p < end && *p == ',') {
+				++p;
+				skipBlanks(p, end);
+				valid = parseColor(p, end, color);
+			}
+			skipBlanks(p, end);
+			valid = valid && (p == end || *p == '\n');
+		}
+		if (valid)
+			addBox(values, values + 3, color, chunk.m_boxes);
+		else
+			++chunk.m_skippedRecords;
+		skipLine(p, end);
+	}
+}
+
+
+void BoxImporter::parseJSON(const char * p, const char * chunkEnd, Chunk & chunk) const {
+	const char * end = m_data + m_size;
+	const QRgb defaultColor = m_defaultColor.rgba();
+	// each '{' starts a box object
+	while (p < chunkEnd && (p = std::find(p, chunkEnd, '{')) != chunkEnd) {
+		++p;
+		float center[3], size[3];
+		bool hasCenter = false, hasSize = false;
+		QRgb color = defaultColor;
+		bool valid = true;
+		for (;;) {
+			skipWhitespace(p, end);
+			if (p < end && *p == '}')
+				break;
+			// "key" : value
+			const char * key = p;
+			valid = (p < end && *p == '"');
+			if (valid) {
+				key = ++p;
+				p = std::find(p, end, '"');
+			}
+			const char * keyEnd = p;
+			if (valid && p < end) {
+				++p;
+				skipWhitespace(p, end);
+				valid = (p < end && *p == ':');
+			}
+			else
+				valid = false;
+			if (!valid)
+				break;
+			++p;
+			skipWhitespace(p, end);
+
+			float * vec = nullptr;
+			if (isKey(key, keyEnd, "center")) {
+				vec = center;
+				hasCenter = true;
+			}
+			else if (isKey(key, keyEnd, "size")) {
+				vec = size;
+				hasSize = true;
+			}
+			if (vec != nullptr) {
+				valid = (p < end && *p == '[');
+				if (valid) {
+					++p;
+					valid = parseFloatList(p, end, vec, 3, true);
+					skipWhitespace(p, end);
+					valid = valid && p < end && *p == ']';
+					++p;
+				}
+			}
+			else if (isKey(key, keyEnd, "color")) {
+				valid = (p < end && *p == '"');
+				if (valid) {
+					++p;
+					valid = parseColor(p, end, color) && p < end && *p == '"';
+					++p;
+				}
+			}
+			else {
+				// unknown key, skip value
+				while (p < end && *p != ',' && *p != '}')
+					++p;
+			}
+			if (!valid)
+				break;
+			skipWhitespace(p, end);
+			if (p < end && *p == ',')
+				++p;
+		}
+		if (valid && hasCenter && hasSize)
+			addBox(center, size, color, chunk.m_boxes);
+		else
+			++chunk.m_skippedRecords;
+		// continue after the end of the object
+		p = std::find(std::min(p, end), end, '}');
+		if (p == end)
+			break;
+		++p;
+	}
+}
+
+
+void BoxImporter::parseOBJ(const char * p, const char * chunkEnd, Chunk & chunk) const {
+	const char * end = m_data + m_size;
+	if (p != m_data && p[-1] != '\n')
+		skipLine(p, end);
+
+	while (p < chunkEnd) {
+		skipBlanks(p, end);
+		if (end - p >= 2 && p[0] == 'v' && isBlank(p[1])) {
+			float coords[3];
+			++p;
+			bool valid = true;
+			for (int i=0; i<3 && valid; ++i) {
+				skipBlanks(p, end);
+				valid = parseFloat(p, end, coords[i]);
+			}
+			// vertexes must always be counted, since faces reference them by index
+			if (!valid) {
+				coords[0] = coords[1] = coords[2] = 0;
+				++chunk.m_skippedRecords;
+			}
+			chunk.m_objVertices.push_back(QVector3D(coords[0], coords[1], coords[2]));
+		}
+		else if (end - p >= 2 && p[0] == 'f' && isBlank(p[1])) {
+			++p;
+			ObjFace face;
+			face.m_chunkVertexCount = chunk.m_objVertices.size();
+			int vertexCount = 0;
+			bool valid = true;
+			for (;;) {
+				skipBlanks(p, end);
+				if (p == end || *p == '\n')
+					break;
+				int id;
+				valid = parseInt(p, end, id) && id != 0;
+				if (!valid)
+					break;
+				if (vertexCount < 4)
+					face.m_vertexIds[vertexCount] = id;
+				++vertexCount;
+				// skip texture and normal indexes "v/vt/vn"
+				while (p < end && !isBlank(*p) && *p != '\n')
+					++p;
+			}
+			if (valid && vertexCount == 4)
+				chunk.m_objFaces.push_back(face);
+			else
+				++chunk.m_skippedRecords;
+		}
+		skipLine(p, end);
+	}
+}
+
+
+void BoxImporter::createObjBoxes(Chunk & chunk, BoxStore & boxes) {
+	unsigned int chunkFirstVertex = m_objVertices.size();
+	m_objVertices.insert(m_objVertices.end(), chunk.m_objVertices.begin(), chunk.m_objVertices.end());
+
+	const QRgb color = m_defaultColor.rgba();
+	const QRgb faceColors[6] = {color, color, color, color, color, color};
+	for (const ObjFace & face : chunk.m_objFaces) {
+		// vertexes defined before the face
+		int vertexCount = int(chunkFirstVertex + face.m_chunkVertexCount);
+		QVector3D c[4];
+		bool valid = true;
+		for (int i=0; i<4 && valid; ++i) {
+			int id = face.m_vertexIds[i];
+			int idx = id > 0 ? id - 1 : vertexCount + id;
+			valid = (idx >= 0 && idx < vertexCount);
+			if (valid)
+				c[i] = m_objVertices[idx];
+		}
+		// The box spans the face edges a-b and a-d (exact for rectangles), with the front side in the face plane.
+		QVector3D u = c[1] - c[0];
+		QVector3D v = c[3] - c[0];
+		QVector3D n = QVector3D::crossProduct(u, v);
+		float width = u.length();
+		if (!valid || width == 0.f || n.lengthSquared() == 0.f) {
+			++m_skippedRecords;
+			continue;
+		}
+		u /= width;
+		n.normalize();
+		QVector3D vDir = QVector3D::crossProduct(n, u);
+		float height = QVector3D::dotProduct(v, vDir);
+		QVector3D center = c[0] + 0.5f*width*u + 0.5f*height*vDir - 0.5f*m_objThickness*n;
+
+		// box corners, transformed into the coordinate system with the box axes and center
+		QVector3D vertices[8];
+		BoxMesh::boxVertices(QVector3D(0,0,0), QVector3D(width, height, m_objThickness), vertices);
+		for (QVector3D & p : vertices)
+			p = center + p.x()*u + p.y()*vDir + p.z()*n;
+		boxes.push_back(vertices, faceColors);
+	}
+}
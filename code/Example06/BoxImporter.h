@@ -0,0 +1,146 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef BOXIMPORTER_H
+#define BOXIMPORTER_H
+
+#include <QColor>
+#include <QFile>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector3D>
+
+#include <vector>
+
+#include "BoxStore.h"
+
+/*! Imports boxes from large files, while the file is parsed in the background.
+
+	Supported formats (selected by file suffix):
+	- CSV (.csv): one box per line "x,y,z,width,height,depth[,#rrggbb]" with the box center x,y,z.
+	  Empty lines and lines starting with # are ignored.
+	- JSON (.json): an array of flat objects {"center":[x,y,z], "size":[w,h,d], "color":"#rrggbb"}
+	  ("color" is optional).
+	- OBJ (.obj): each face with 4 vertexes (a rectangular building element) becomes a box, with
+	  the face as front side and m_objThickness as depth. Other faces and all other statements
+	  are ignored.
+	Lines/objects that cannot be parsed (e.g. a CSV header line) are skipped and counted.
+
+	The file is memory-mapped and split into chunks of ChunkSize bytes, which are parsed in the global
+	thread pool. A record belongs to the chunk holding its first character, so each chunk can find its
+	first record without knowing the previous chunk. Parsed boxes are collected with takeBoxes() in file order,
+	e.g. once per frame, so that the first part of the model can be shown while the rest is still loading.
+	Only a limited number of chunks is parsed ahead of takeBoxes(), so memory use does not depend on the
+	file size.
+
+	OBJ faces reference vertexes by their global index, so chunks only parse vertexes and faces, and
+	boxes are created in takeBoxes() in file order.
+*/
+class BoxImporter {
+public:
+	enum Format {
+		F_CSV,
+		F_JSON,
+		F_OBJ,
+		NUM_F
+	};
+
+	/*! Size of the chunks parsed by a thread pool task in bytes. */
+	static const unsigned int ChunkSize = 4*1024*1024;
+
+	BoxImporter();
+	/*! Stops parsing (see cancel()). */
+	~BoxImporter() { cancel(); }
+
+	/*! Returns the format for the suffix of the file name, or NUM_F if unknown. */
+	static Format formatFromFileName(const QString & fileName);
+
+	/*! Opens and maps the file and starts parsing the first chunks. Returns false, if the file cannot be
+		opened or if the format is unknown.
+	*/
+	bool start(const QString & fileName);
+	/*! Appends the boxes of all chunks parsed so far, in file order, to boxes and starts parsing
+		further chunks. If wait is true, the function waits until at least one chunk has been parsed.
+		Returns the number of boxes appended.
+	*/
+	unsigned int takeBoxes(BoxStore & boxes, bool wait = false);
+	/*! Returns true from start() until all chunks have been taken or the import was canceled. */
+	bool isRunning() const { return m_data != nullptr; }
+	/*! Waits for running chunks and closes the file. */
+	void cancel();
+
+	/*! Size of the file being imported in bytes. */
+	quint64 fileSize() const { return m_size; }
+	/*! Number of bytes parsed and taken so far. */
+	quint64 bytesTaken() const;
+
+	/*! Thickness of boxes created from OBJ faces. */
+	float			m_objThickness;
+	/*! Color of boxes without color information. */
+	QColor			m_defaultColor;
+	/*! Number of skipped lines/objects so far. */
+	unsigned int	m_skippedRecords;
+
+private:
+	/*! An OBJ face, as stored in the file. */
+	struct ObjFace {
+		/*! Vertex indexes, 1-based or relative (negative). */
+		int				m_vertexIds[4];
+		/*! Number of vertexes in the chunk before this face, needed to resolve relative indexes. */
+		unsigned int	m_chunkVertexCount;
+	};
+
+	/*! Parse result of a chunk. */
+	struct Chunk {
+		/*! Boxes (CSV and JSON). */
+		BoxStore					m_boxes;
+		/*! Vertexes and faces (OBJ). */
+		std::vector<QVector3D>		m_objVertices;
+		std::vector<ObjFace>		m_objFaces;
+		unsigned int				m_skippedRecords = 0;
+		/*! Set by the thread pool task when parsing is done, protected by m_mutex. */
+		bool						m_done = false;
+	};
+
+	/*! Starts thread pool tasks for the next chunks, until MaxChunksAhead chunks are not yet taken. */
+	void startChunks();
+	/*! Parses chunk chunkId, called from a thread pool task. */
+	void parseChunk(unsigned int chunkId);
+	void parseCSV(const char * p, const char * chunkEnd, Chunk & chunk) const;
+	void parseJSON(const char * p, const char * chunkEnd, Chunk & chunk) const;
+	void parseOBJ(const char * p, const char * chunkEnd, Chunk & chunk) const;
+	/*! Creates the boxes for the faces of an OBJ chunk, called in file order. */
+	void createObjBoxes(Chunk & chunk, BoxStore & boxes);
+
+	QFile					m_file;
+	Format					m_format = NUM_F;
+	/*! Mapped file content, nullptr if no import is running. */
+	const char				*m_data = nullptr;
+	quint64					m_size = 0;
+
+	/*! Results of all chunks, chunks are cleared when taken. */
+	std::vector<Chunk>		m_chunks;
+	/*! Next chunk to be started. */
+	unsigned int			m_nextChunk = 0;
+	/*! Next chunk to be taken. */
+	unsigned int			m_nextTakenChunk = 0;
+	/*! Number of chunks started, but not finished yet. */
+	unsigned int			m_runningChunks = 0;
+	/*! Protects m_done of all chunks and m_runningChunks. */
+	QMutex					m_mutex;
+	/*! Signaled whenever a chunk is done. */
+	QWaitCondition			m_chunkDone;
+
+	/*! All OBJ vertexes of the chunks taken so far. */
+	std::vector<QVector3D>	m_objVertices;
+};
+
+#endif // BOXIMPORTER_H
@@ -0,0 +1,188 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "BoxLOD.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "BoxGrid.h"
+
+/*! Appends a box with the given bounds to the store, with the face colors of box colorBoxId in source. */
+static void appendProxy(BoxStore & proxies, const QVector3D & minCorner, const QVector3D & maxCorner,
+						const BoxStore & source, unsigned int colorBoxId)
+{
+	QVector3D vertices[8];
+	BoxMesh::boxVertices(0.5f*(minCorner + maxCorner), maxCorner - minCorner, vertices);
+	proxies.push_back(vertices, source.m_colors.data() + colorBoxId*6);
+}
+
+
+/*! Extends the bounding box minCorner...maxCorner to enclose the bounding box bmin...bmax. */
+static void enclose(QVector3D & minCorner, QVector3D & maxCorner, const QVector3D & bmin, const QVector3D & bmax) {
+	for (int j=0; j<3; ++j) {
+		minCorner[j] = std::min(minCorner[j], bmin[j]);
+		maxCorner[j] = std::max(maxCorner[j], bmax[j]);
+	}
+}
+
+
+void BoxLOD::build(const BoxStore & boxes, const BoxGrid & grid) {
+	Q_ASSERT(!grid.m_cells.empty());
+	const unsigned int dimX = grid.m_dim[0];
+	const unsigned int dimZ = grid.m_dim[2];
+	unsigned int tileDimX = (dimX + TileCells - 1)/TileCells;
+	unsigned int tileDimZ = (dimZ + TileCells - 1)/TileCells;
+
+	// keep the chosen levels, so that the hysteresis also works while boxes are modified
+	std::vector<Level> levels;
+	if (tileDimX == m_tileDim[0] && tileDimZ == m_tileDim[1])
+		for (const Tile & tile : m_tiles)
+			levels.push_back(tile.m_level);
+	m_tileDim[0] = tileDimX;
+	m_tileDim[1] = tileDimZ;
+	const unsigned int tileCount = tileDimX*tileDimZ;
+	m_tiles.assign(tileCount, Tile());
+	for (unsigned int t=0; t<levels.size(); ++t)
+		m_tiles[t].m_level = levels[t];
+
+	// bounding box of the boxes stacked in each column, and the box providing the face colors of the column
+	std::vector<QVector3D> columnMin(dimX*dimZ);
+	std::vector<QVector3D> columnMax(dimX*dimZ);
+	std::vector<int> columnColorBox(dimX*dimZ, -1);
+	// bounding box of all boxes per tile, and boxes not fitting into a single column
+	std::vector<QVector3D> tileMin(tileCount);
+	std::vector<QVector3D> tileMax(tileCount);
+	std::vector< std::vector<unsigned int> > unalignedBoxes(tileCount);
+
+	for (unsigned int i=0; i<boxes.size(); ++i) {
+		QVector3D bmin, bmax;
+		boxes.boundingBox(i, bmin, bmax);
+		// column containing the box center, boxes outside the lattice are assigned to the nearest column
+		QVector3D center = 0.5f*(bmin + bmax);
+		int ci = (int)std::floor((center.x() - grid.m_origin.x())/grid.m_cellSize.x());
+		int ck = (int)std::floor((center.z() - grid.m_origin.z())/grid.m_cellSize.z());
+		ci = std::max(0, std::min((int)dimX - 1, ci));
+		ck = std::max(0, std::min((int)dimZ - 1, ck));
+
+		unsigned int t = (ck/TileCells)*tileDimX + ci/TileCells;
+		Tile & tile = m_tiles[t];
+		if (!tile.m_boxRanges.empty() && tile.m_boxRanges.back().m_first + tile.m_boxRanges.back().m_count == i)
+			++tile.m_boxRanges.back().m_count;
+		else
+			tile.m_boxRanges.push_back(ElementBatches::Range{i, 1});
+		if (tile.m_boxCount++ == 0) {
+			tileMin[t] = bmin;
+			tileMax[t] = bmax;
+		}
+		else
+			enclose(tileMin[t], tileMax[t], bmin, bmax);
+
+		// box must be within the footprint of the column
+		float x0 = grid.m_origin.x() + ci*grid.m_cellSize.x();
+		float z0 = grid.m_origin.z() + ck*grid.m_cellSize.z();
+		if (bmin.x() < x0 || bmax.x() > x0 + grid.m_cellSize.x() || bmin.z() < z0 || bmax.z() > z0 + grid.m_cellSize.z()) {
+			unalignedBoxes[t].push_back(i);
+			continue;
+		}
+		unsigned int col = ck*dimX + ci;
+		if (columnColorBox[col] == -1) {
+			columnColorBox[col] = (int)i;
+			columnMin[col] = bmin;
+			columnMax[col] = bmax;
+		}
+		else {
+			enclose(columnMin[col], columnMax[col], bmin, bmax);
+			// the top face is the visible one, so take the colors of the highest box
+			if (bmax.y() >= columnMax[col].y())
+				columnColorBox[col] = (int)i;
+		}
+	}
+
+	m_proxies.clear();
+	m_tileBounds.resize(tileCount);
+	for (unsigned int tk=0; tk<tileDimZ; ++tk) {
+		for (unsigned int ti=0; ti<tileDimX; ++ti) {
+			unsigned int t = tk*tileDimX + ti;
+			Tile & tile = m_tiles[t];
+			unsigned int firstCol[2] = {ti*TileCells, tk*TileCells};
+			unsigned int lastCol[2] = {std::min(firstCol[0] + TileCells, dimX), std::min(firstCol[1] + TileCells, dimZ)};
+
+			// one box per column
+			tile.m_proxies[L_Columns].m_first = m_proxies.size();
+			for (unsigned int k=firstCol[1]; k<lastCol[1]; ++k)
+				for (unsigned int i=firstCol[0]; i<lastCol[0]; ++i) {
+					unsigned int col = k*dimX + i;
+					if (columnColorBox[col] != -1)
+						appendProxy(m_proxies, columnMin[col], columnMax[col], boxes, columnColorBox[col]);
+				}
+			for (unsigned int boxId : unalignedBoxes[t])
+				m_proxies.push_back(boxes.m_vertices.data() + boxId*8, boxes.m_colors.data() + boxId*6);
+			tile.m_proxies[L_Columns].m_count = m_proxies.size() - tile.m_proxies[L_Columns].m_first;
+
+			// one block per HeightfieldCells x HeightfieldCells columns, enclosing all columns
+			tile.m_proxies[L_Heightfield].m_first = m_proxies.size();
+			for (unsigned int bk=firstCol[1]; bk<lastCol[1]; bk+=HeightfieldCells)
+				for (unsigned int bi=firstCol[0]; bi<lastCol[0]; bi+=HeightfieldCells) {
+					QVector3D blockMin, blockMax;
+					int colorBox = -1;
+					for (unsigned int k=bk; k<std::min(bk + HeightfieldCells, lastCol[1]); ++k)
+						for (unsigned int i=bi; i<std::min(bi + HeightfieldCells, lastCol[0]); ++i) {
+							unsigned int col = k*dimX + i;
+							if (columnColorBox[col] == -1)
+								continue;
+							if (colorBox == -1) {
+								blockMin = columnMin[col];
+								blockMax = columnMax[col];
+								colorBox = columnColorBox[col];
+								continue;
+							}
+							if (columnMax[col].y() > blockMax.y())
+								colorBox = columnColorBox[col];
+							enclose(blockMin, blockMax, columnMin[col], columnMax[col]);
+						}
+					if (colorBox != -1)
+						appendProxy(m_proxies, blockMin, blockMax, boxes, colorBox);
+				}
+			for (unsigned int boxId : unalignedBoxes[t])
+				m_proxies.push_back(boxes.m_vertices.data() + boxId*8, boxes.m_colors.data() + boxId*6);
+			tile.m_proxies[L_Heightfield].m_count = m_proxies.size() - tile.m_proxies[L_Heightfield].m_first;
+
+			// empty tiles get the (flat) footprint of their columns as bounding box
+			if (tile.m_boxCount == 0) {
+				tileMin[t] = QVector3D(grid.m_origin.x() + firstCol[0]*grid.m_cellSize.x(), grid.m_origin.y(),
+									   grid.m_origin.z() + firstCol[1]*grid.m_cellSize.z());
+				tileMax[t] = QVector3D(grid.m_origin.x() + lastCol[0]*grid.m_cellSize.x(), grid.m_origin.y(),
+									   grid.m_origin.z() + lastCol[1]*grid.m_cellSize.z());
+			}
+			m_tileBounds.set(t, tileMin[t], tileMax[t]);
+		}
+	}
+}
+
+
+void BoxLOD::selectLevels(const QVector3D & viewPos) {
+	for (unsigned int t=0; t<m_tiles.size(); ++t) {
+		// distance to the closest point of the tile's bounding box (0 if inside)
+		float dx = std::max(std::max(m_tileBounds.m_minX[t] - viewPos.x(), viewPos.x() - m_tileBounds.m_maxX[t]), 0.f);
+		float dy = std::max(std::max(m_tileBounds.m_minY[t] - viewPos.y(), viewPos.y() - m_tileBounds.m_maxY[t]), 0.f);
+		float dz = std::max(std::max(m_tileBounds.m_minZ[t] - viewPos.z(), viewPos.z() - m_tileBounds.m_maxZ[t]), 0.f);
+		float dist = std::sqrt(dx*dx + dy*dy + dz*dz);
+
+		// coarser levels only beyond the switch distance plus hysteresis, finer levels only below the
+		// switch distance minus hysteresis
+		Level & level = m_tiles[t].m_level;
+		while (level + 1 < NUM_L && dist > m_switchDistances[level]*(1 + m_hysteresis))
+			level = Level(level + 1);
+		while (level > L_Boxes && dist < m_switchDistances[level - 1]*(1 - m_hysteresis))
+			level = Level(level - 1);
+	}
+}
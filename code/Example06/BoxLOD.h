@@ -0,0 +1,95 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef BOXLOD_H
+#define BOXLOD_H
+
+#include <QVector3D>
+#include <vector>
+
+#include "BoxBounds.h"
+#include "BoxStore.h"
+#include "ElementBatches.h"
+
+class BoxGrid;
+
+/*! Levels of detail for the boxes of a BoxObject, defined on the columns of its lattice (see BoxGrid).
+
+	The lattice is split into square tiles of TileCells x TileCells columns. Per tile, there are three
+	representations:
+	- L_Boxes: all boxes of the tile (ranges of box indexes)
+	- L_Columns: one box per lattice column, enclosing all boxes stacked in this column
+	- L_Heightfield: a coarse heightfield with one block per HeightfieldCells x HeightfieldCells columns,
+	  as high as the highest column
+
+	The merged boxes (proxies) of all tiles are stored in m_proxies, each tile's proxies of a level are
+	consecutive. Boxes that do not fit into a single column (e.g. the coordinate system boxes) are not
+	merged, but copied into each level as they are.
+
+	selectLevels() chooses the level of each tile from the distance between the viewer and the tile's
+	bounding box. A tile switches to a coarser level only once it is beyond the switch distance plus
+	m_hysteresis, and back to the finer level only once it is closer than the switch distance minus
+	m_hysteresis. Thus, tiles near a switch distance do not flip back and forth (popping) with small
+	camera movements.
+*/
+class BoxLOD {
+public:
+	/*! Levels of detail, from finest to coarsest. */
+	enum Level {
+		L_Boxes,
+		L_Columns,
+		L_Heightfield,
+		NUM_L
+	};
+
+	/*! A tile of lattice columns. */
+	struct Tile {
+		/*! Boxes of the tile (indexes in the box store, consecutive boxes are merged into one range). */
+		std::vector<ElementBatches::Range>	m_boxRanges;
+		/*! Proxies in m_proxies for levels L_Columns and L_Heightfield (m_proxies[L_Boxes] is unused). */
+		ElementBatches::Range				m_proxies[NUM_L];
+		/*! Number of boxes in the tile. */
+		unsigned int						m_boxCount = 0;
+		/*! Level chosen in the last call to selectLevels(). */
+		Level								m_level = L_Boxes;
+	};
+
+	/*! Number of lattice columns per tile in x and z direction. */
+	static const unsigned int TileCells = 10;
+	/*! Number of lattice columns per heightfield block in x and z direction (TileCells must be a multiple). */
+	static const unsigned int HeightfieldCells = 2;
+
+	/*! Sorts the boxes into the tiles of the lattice and creates the proxies of all tiles.
+		The levels chosen so far are kept, as long as the lattice is unchanged.
+	*/
+	void build(const BoxStore & boxes, const BoxGrid & grid);
+
+	/*! Chooses the level of detail of each tile for the given viewer position. */
+	void selectLevels(const QVector3D & viewPos);
+
+	/*! All tiles, row by row (x direction first). */
+	std::vector<Tile>	m_tiles;
+	/*! Bounding boxes of the tiles (all boxes of the tile, or the lattice footprint of empty tiles). */
+	BoxBounds			m_tileBounds;
+	/*! Merged boxes of all tiles and levels. */
+	BoxStore			m_proxies;
+
+	/*! Distances, beyond which tiles switch from L_Boxes to L_Columns, and from L_Columns to L_Heightfield. */
+	float				m_switchDistances[NUM_L - 1] = {100, 200};
+	/*! Relative width of the hysteresis band around the switch distances. */
+	float				m_hysteresis = 0.1f;
+
+private:
+	/*! Number of tiles in x and z direction. */
+	unsigned int		m_tileDim[2] = {0, 0};
+};
+
+#endif // BOXLOD_H
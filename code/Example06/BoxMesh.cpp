@@ -10,124 +10,287 @@ License    : BSD License,
 ************************************************************************************/
 
 #include "BoxMesh.h"
+#include "ElementBatches.h"
 #include "PickObject.h"
 
-void copyPlane2Buffer(VertexVNC *& vertexBuffer, GLuint * & elementBuffer, unsigned int & elementStartIndex,
-					  const VertexVNC & a, const VertexVNC & b, const VertexVNC & c, const VertexVNC & d);
+void copyPlane2Buffer(VertexPNC *& vertexBuffer, GLuint * & elementBuffer, unsigned int & elementStartIndex,
+					  const VertexPNC & a, const VertexPNC & b, const VertexPNC & c, const VertexPNC & d);
 
 
 BoxMesh::BoxMesh(float width, float height, float depth, QColor boxColor) {
+	m_vertices.resize(8);
+	boxVertices(QVector3D(0,0,0), QVector3D(width, height, depth), m_vertices.data());
+	setColor(boxColor);
+	updatePlaneInfo();
+}
 
-	m_vertices.push_back(QVector3D(-0.5f*width, -0.5f*height,  0.5f*depth)); // a = 0
-	m_vertices.push_back(QVector3D( 0.5f*width, -0.5f*height,  0.5f*depth)); // b = 1
-	m_vertices.push_back(QVector3D( 0.5f*width,  0.5f*height,  0.5f*depth)); // c = 2
-	m_vertices.push_back(QVector3D(-0.5f*width,  0.5f*height,  0.5f*depth)); // d = 3
 
-	m_vertices.push_back(QVector3D(-0.5f*width, -0.5f*height, -0.5f*depth)); // e = 4
-	m_vertices.push_back(QVector3D( 0.5f*width, -0.5f*height, -0.5f*depth)); // f = 5
-	m_vertices.push_back(QVector3D( 0.5f*width,  0.5f*height, -0.5f*depth)); // g = 6
-	m_vertices.push_back(QVector3D(-0.5f*width,  0.5f*height, -0.5f*depth)); // h = 7
+void BoxMesh::boxVertices(const QVector3D & center, const QVector3D & size, QVector3D * vertices) {
+	QVector3D h = 0.5f*size;
+	vertices[0] = center + QVector3D(-h.x(), -h.y(),  h.z()); // a = 0
+	vertices[1] = center + QVector3D( h.x(), -h.y(),  h.z()); // b = 1
+	vertices[2] = center + QVector3D( h.x(),  h.y(),  h.z()); // c = 2
+	vertices[3] = center + QVector3D(-h.x(),  h.y(),  h.z()); // d = 3
 
-	setColor(boxColor);
+	vertices[4] = center + QVector3D(-h.x(), -h.y(), -h.z()); // e = 4
+	vertices[5] = center + QVector3D( h.x(), -h.y(), -h.z()); // f = 5
+	vertices[6] = center + QVector3D( h.x(),  h.y(), -h.z()); // g = 6
+	vertices[7] = center + QVector3D(-h.x(),  h.y(), -h.z()); // h = 7
 }
 
 
 void BoxMesh::transform(const QMatrix4x4 & transform) {
 	for (QVector3D & v : m_vertices)
 		v = transform*v;
+	updatePlaneInfo();
 }
 
 
 bool BoxMesh::intersects(unsigned int planeIdx, const QVector3D & p1, const QVector3D & d, float & dist) const {
-	const Rect & p = m_planeInfo[planeIdx];
-	return intersectsRect(p.m_a, p.m_b, p.m_normal, p.m_offset, p1, d, dist);
+	return intersects(m_planeInfo[planeIdx], p1, d, dist);
 }
 
 
-void BoxMesh::copy2Buffer(VertexVNC *& vertexBuffer, GLuint *& elementBuffer, unsigned int & elementStartIndex) const {
-	std::vector<QColor> cols;
-	Q_ASSERT(!m_colors.empty());
-	// three ways to store vertex colors
-	if (m_colors.size() == 1) {
-		cols = std::vector<QColor>(6, m_colors[0]);
-	}
-	else {
-		Q_ASSERT(m_colors.size() == 6);
-		cols = m_colors;
+bool BoxMesh::intersectsLegacy(unsigned int planeIdx, const QVector3D & p1, const QVector3D & d, float & dist) const {
+	return intersectsLegacy(m_planeInfo[planeIdx], p1, d, dist);
+}
+
+
+bool BoxMesh::intersects(const Rect & r, const QVector3D & p1, const QVector3D & d, float & dist) {
+#ifdef LEGACY_RECT_TEST
+	return intersectsLegacy(r, p1, d, dist);
+#else
+	// The line hits the plane at t = ((offset - p1)*n) / (d*n). We only accept hits on the front side of
+	// the face (d*n < 0) and with t in [0..1], so we can check t without division: with det = d*n < 0,
+	// the condition 0 <= t <= 1 becomes det <= tDet <= 0.
+	float det = QVector3D::dotProduct(d, r.m_n);
+	float tDet = QVector3D::dotProduct(r.m_offset - p1, r.m_n);
+	if (!((det < 0) & (tDet <= 0) & (tDet >= det)))
+		return false;
+
+	// local coordinates of intersection point, the inverse determinant is part of m_u and m_v
+	float t = tDet/det;
+	QVector3D rhs = p1 + t*d - r.m_offset;
+	float u = QVector3D::dotProduct(rhs, r.m_u);
+	float v = QVector3D::dotProduct(rhs, r.m_v);
+	if (!((u > 0) & (u < 1) & (v > 0) & (v < 1)))
+		return false;
+
+	dist = t;
+	return true;
+#endif // LEGACY_RECT_TEST
+}
+
+
+bool BoxMesh::intersectsLegacy(const Rect & r, const QVector3D & p1, const QVector3D & d, float & dist) {
+	return intersectsRect(r.m_a, r.m_b, r.m_normal, r.m_offset, p1, d, dist);
+}
+
+
+void BoxMesh::boundingBox(QVector3D & minCorner, QVector3D & maxCorner) const {
+	boundingBox(m_vertices.data(), minCorner, maxCorner);
+}
+
+
+void BoxMesh::boundingBox(const QVector3D * vertices, QVector3D & minCorner, QVector3D & maxCorner) {
+	minCorner = vertices[0];
+	maxCorner = vertices[0];
+	for (unsigned int i=1; i<8; ++i) {
+		const QVector3D & v = vertices[i];
+		minCorner = QVector3D(qMin(minCorner.x(), v.x()), qMin(minCorner.y(), v.y()), qMin(minCorner.z(), v.z()));
+		maxCorner = QVector3D(qMax(maxCorner.x(), v.x()), qMax(maxCorner.y(), v.y()), qMax(maxCorner.z(), v.z()));
 	}
+}
+
+
+void BoxMesh::faceColors(QRgb cols[6]) const {
+	Q_ASSERT(m_colors.size() == 1 || m_colors.size() == 6);
+	for (unsigned int i=0; i<6; ++i)
+		cols[i] = (m_colors.size() == 1 ? m_colors[0] : m_colors[i]).rgba();
+}
+
+
+void BoxMesh::copy2Buffer(VertexPNC *& vertexBuffer, GLuint *& elementBuffer, unsigned int & elementStartIndex) const {
+	QRgb cols[6];
+	faceColors(cols);
+	copy2Buffer(m_vertices.data(), cols, vertexBuffer, elementBuffer, elementStartIndex);
+}
+
+
+void BoxMesh::copy2Buffer(const QVector3D * vertices, const QRgb * faceColors,
+						  VertexPNC *& vertexBuffer, GLuint *& elementBuffer, unsigned int & elementStartIndex)
+{
+	QColor cols[6];
+	for (unsigned int i=0; i<6; ++i)
+		cols[i] = QColor::fromRgba(faceColors[i]);
 
 	// now we populate the vertex buffer for all planes
 
 	// front plane: a, b, c, d, vertexes (0, 1, 2, 3)
 	QVector3D normal(0,0,1);
 	copyPlane2Buffer(vertexBuffer, elementBuffer, elementStartIndex,
-			VertexVNC(m_vertices[0], normal, cols[0]),
-			VertexVNC(m_vertices[1], normal, cols[0]),
-			VertexVNC(m_vertices[2], normal, cols[0]),
-			VertexVNC(m_vertices[3], normal, cols[0])
+			VertexPNC(vertices[0], normal, cols[0]),
+			VertexPNC(vertices[1], normal, cols[0]),
+			VertexPNC(vertices[2], normal, cols[0]),
+			VertexPNC(vertices[3], normal, cols[0])
 		);
 
 	// right plane: b=1, f=5, g=6, c=2, vertexes
 	normal = QVector3D(1,0,0);
 	// Mind: colors are numbered up
 	copyPlane2Buffer(vertexBuffer, elementBuffer, elementStartIndex,
-			VertexVNC(m_vertices[1], normal, cols[1]),
-			VertexVNC(m_vertices[5], normal, cols[1]),
-			VertexVNC(m_vertices[6], normal, cols[1]),
-			VertexVNC(m_vertices[2], normal, cols[1])
+			VertexPNC(vertices[1], normal, cols[1]),
+			VertexPNC(vertices[5], normal, cols[1]),
+			VertexPNC(vertices[6], normal, cols[1]),
+			VertexPNC(vertices[2], normal, cols[1])
 		);
 
 	// back plane: g=5, e=4, h=7, g=6
 	normal = QVector3D(0,0,-1);
 	copyPlane2Buffer(vertexBuffer, elementBuffer, elementStartIndex,
-			VertexVNC(m_vertices[5], normal, cols[2]),
-			VertexVNC(m_vertices[4], normal, cols[2]),
-			VertexVNC(m_vertices[7], normal, cols[2]),
-			VertexVNC(m_vertices[6], normal, cols[2])
+			VertexPNC(vertices[5], normal, cols[2]),
+			VertexPNC(vertices[4], normal, cols[2]),
+			VertexPNC(vertices[7], normal, cols[2]),
+			VertexPNC(vertices[6], normal, cols[2])
 		);
 
 	// left plane: 4,0,3,7
 	normal = QVector3D(-1,0,0);
 	copyPlane2Buffer(vertexBuffer, elementBuffer, elementStartIndex,
-			VertexVNC(m_vertices[4], normal, cols[3]),
-			VertexVNC(m_vertices[0], normal, cols[3]),
-			VertexVNC(m_vertices[3], normal, cols[3]),
-			VertexVNC(m_vertices[7], normal, cols[3])
+			VertexPNC(vertices[4], normal, cols[3]),
+			VertexPNC(vertices[0], normal, cols[3]),
+			VertexPNC(vertices[3], normal, cols[3]),
+			VertexPNC(vertices[7], normal, cols[3])
 		);
 
 	// bottom plane: 4,5,1,0
 	normal = QVector3D(0,-1,0);
 	copyPlane2Buffer(vertexBuffer, elementBuffer, elementStartIndex,
-			VertexVNC(m_vertices[4], normal, cols[4]),
-			VertexVNC(m_vertices[5], normal, cols[4]),
-			VertexVNC(m_vertices[1], normal, cols[4]),
-			VertexVNC(m_vertices[0], normal, cols[4])
+			VertexPNC(vertices[4], normal, cols[4]),
+			VertexPNC(vertices[5], normal, cols[4]),
+			VertexPNC(vertices[1], normal, cols[4]),
+			VertexPNC(vertices[0], normal, cols[4])
 		);
 
 	// top plane: 3,2,6,7
 	normal = QVector3D(0,1,0);
 	copyPlane2Buffer(vertexBuffer, elementBuffer, elementStartIndex,
-			VertexVNC(m_vertices[3], normal, cols[5]),
-			VertexVNC(m_vertices[2], normal, cols[5]),
-			VertexVNC(m_vertices[6], normal, cols[5]),
-			VertexVNC(m_vertices[7], normal, cols[5])
+			VertexPNC(vertices[3], normal, cols[5]),
+			VertexPNC(vertices[2], normal, cols[5]),
+			VertexPNC(vertices[6], normal, cols[5]),
+			VertexPNC(vertices[7], normal, cols[5])
 		);
+}
 
+
+void BoxMesh::copyStripElements2Buffer(GLuint *& elementBuffer, unsigned int & elementStartIndex) {
+	for (unsigned int i=0; i<6; ++i) {
+		// vertexes a, b, c, d of a face (see copyPlane2Buffer()) give triangles a, b, d  and  d, b, c as strip a, b, d, c,
+		// i.e. the same triangles with the same winding
+		elementBuffer[0] = elementStartIndex;
+		elementBuffer[1] = elementStartIndex+1;
+		elementBuffer[2] = elementStartIndex+3;
+		elementBuffer[3] = elementStartIndex+2;
+		elementBuffer[4] = ElementBatches::RestartIndex;
+		elementBuffer += 5;
+		elementStartIndex += 4;
+	}
+}
+
+
+// corners of each face in counter-clockwise order, see copy2Buffer()
+static const unsigned int FaceCorners[6][4] = {
+	{0, 1, 2, 3},	// front
+	{1, 5, 6, 2},	// right
+	{5, 4, 7, 6},	// back
+	{4, 0, 3, 7},	// left
+	{4, 5, 1, 0},	// bottom
+	{3, 2, 6, 7}	// top
+};
+
+// each face is assigned a corner of its own, corners 6 and 7 are left over
+const int BoxMesh::CornerFaces[8] = {0, 1, 5, 3, 4, 2, -1, -1};
+
+
+void BoxMesh::copy2CornerBuffer(const QVector3D * vertices, const QRgb * faceColors, VertexPC *& vertexBuffer) {
+	for (unsigned int i=0; i<8; ++i) {
+		// color of unused corners does not matter
+		int faceId = CornerFaces[i] == -1 ? 0 : CornerFaces[i];
+		vertexBuffer[i] = VertexPC(vertices[i], QColor::fromRgba(faceColors[faceId]));
+	}
+	vertexBuffer += 8;
+}
+
+
+void BoxMesh::copyCornerElements2Buffer(GLuint *& elementBuffer, unsigned int & elementStartIndex) {
+	for (unsigned int faceId=0; faceId<6; ++faceId) {
+		// position k of the face's own corner in the counter-clockwise corner list
+		const unsigned int * c = FaceCorners[faceId];
+		unsigned int k = 0;
+		while (CornerFaces[c[k]] != (int)faceId)
+			++k;
+		// triangles k+1, k+2, k  and  k+2, k+3, k (a fan around corner k, rotated so that corner k is last),
+		// winding remains counter-clockwise
+		elementBuffer[0] = elementStartIndex + c[(k+1) % 4];
+		elementBuffer[1] = elementStartIndex + c[(k+2) % 4];
+		elementBuffer[2] = elementStartIndex + c[k];
+		elementBuffer[3] = elementStartIndex + c[(k+2) % 4];
+		elementBuffer[4] = elementStartIndex + c[(k+3) % 4];
+		elementBuffer[5] = elementStartIndex + c[k];
+		elementBuffer += 6;
+	}
+	elementStartIndex += 8;
+}
+
+
+void BoxMesh::copy2InstanceBuffer(BoxInstance & instance) const {
+	QRgb cols[6];
+	faceColors(cols);
+	copy2InstanceBuffer(m_vertices.data(), cols, instance);
+}
+
+
+void BoxMesh::copy2InstanceBuffer(const QVector3D * vertices, const QRgb * faceColors, BoxInstance & instance) {
+	QVector3D minCorner, maxCorner;
+	boundingBox(vertices, minCorner, maxCorner);
+	QVector3D center = 0.5f*(minCorner + maxCorner);
+	QVector3D scale = maxCorner - minCorner;
+	instance.x = center.x();
+	instance.y = center.y();
+	instance.z = center.z();
+	instance.sx = scale.x();
+	instance.sy = scale.y();
+	instance.sz = scale.z();
+
+	for (unsigned int i=0; i<6; ++i) {
+		instance.colors[i][0] = (unsigned char)qRed(faceColors[i]);
+		instance.colors[i][1] = (unsigned char)qGreen(faceColors[i]);
+		instance.colors[i][2] = (unsigned char)qBlue(faceColors[i]);
+		instance.colors[i][3] = 255;
+	}
+}
+
+
+void BoxMesh::updatePlaneInfo() {
+	m_planeInfo.resize(6);
+	updatePlaneInfo(m_vertices.data(), m_planeInfo.data());
+}
+
+
+void BoxMesh::updatePlaneInfo(const QVector3D * vertices, Rect * planeInfo) {
 	// compute all face normals
-	std::vector<Rect> & planeInfo = const_cast<std::vector<Rect> &>(m_planeInfo);
-	planeInfo.resize(6);
 	// front plane: a, b, c, d, vertexes (0, 1, 2, 3)
-	planeInfo[0] = Rect(m_vertices[0], m_vertices[1], m_vertices[3]);
+	planeInfo[0] = Rect(vertices[0], vertices[1], vertices[3]);
 	// right plane: b=1, f=5, g=6, c=2, vertexes
-	planeInfo[1] = Rect(m_vertices[1], m_vertices[5], m_vertices[2]);
+	planeInfo[1] = Rect(vertices[1], vertices[5], vertices[2]);
 	// back plane: g=5, e=4, h=7, g=6
-	planeInfo[2] = Rect(m_vertices[5], m_vertices[4], m_vertices[6]);
+	planeInfo[2] = Rect(vertices[5], vertices[4], vertices[6]);
 	// left plane: 4,0,3,7
-	planeInfo[3] = Rect(m_vertices[4], m_vertices[0], m_vertices[7]);
+	planeInfo[3] = Rect(vertices[4], vertices[0], vertices[7]);
 	// bottom plane: 4,5,1,0
-	planeInfo[4] = Rect(m_vertices[4], m_vertices[5], m_vertices[0]);
+	planeInfo[4] = Rect(vertices[4], vertices[5], vertices[0]);
 	// top plane: 3,2,6,7
-	planeInfo[5] = Rect(m_vertices[3], m_vertices[2], m_vertices[7]);
+	planeInfo[5] = Rect(vertices[3], vertices[2], vertices[7]);
 }
 
 
@@ -136,12 +299,18 @@ BoxMesh::Rect::Rect(QVector3D a, QVector3D b, QVector3D d) {
 	m_b = d-a;
 	m_normal = QVector3D::crossProduct(m_a, m_b);
 	Q_ASSERT(m_normal.length() != 0.f);
+	m_n = m_normal;
 	m_normal.normalize();
 	m_offset = a;
+
+	// dual vectors of m_a and m_b in the plane: m_u*m_a = 1, m_u*m_b = 0, m_v*m_a = 0, m_v*m_b = 1
+	float invDet = 1.f/m_n.lengthSquared();
+	m_u = invDet*QVector3D::crossProduct(m_b, m_n);
+	m_v = invDet*QVector3D::crossProduct(m_n, m_a);
 }
 
-void copyPlane2Buffer(VertexVNC * & vertexBuffer, GLuint * & elementBuffer, unsigned int & elementStartIndex,
-					  const VertexVNC & a, const VertexVNC & b, const VertexVNC & c, const VertexVNC & d)
+void copyPlane2Buffer(VertexPNC * & vertexBuffer, GLuint * & elementBuffer, unsigned int & elementStartIndex,
+					  const VertexPNC & a, const VertexPNC & b, const VertexPNC & c, const VertexPNC & d)
 {
 	// first store the vertex data (a,b,c,d in counter-clockwise order)
 
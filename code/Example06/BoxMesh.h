@@ -53,19 +53,56 @@ public:
 
 		elementStartIndex is the start index, that we should start indexing our newly added vertexes with.
 	*/
-	void copy2Buffer(VertexVNC * & vertexBuffer,
+	void copy2Buffer(VertexPNC * & vertexBuffer,
 					GLuint * & elementBuffer,
 					unsigned int & elementStartIndex) const;
 
+	/*! Fills in the instance data (translation, scale and face colors) for rendering the box as scaled unit cube.
+		The unit cube is scaled to the bounding box, so this is only exact for axis-aligned boxes.
+	*/
+	void copy2InstanceBuffer(BoxInstance & instance) const;
+
 	static const unsigned int VertexCount = 6*4;  // 6 faces, 4 vertexes each (because each may have different number of colors)
 	static const unsigned int IndexCount = 6*2*3; // 6 faces, 2 triangles each, 3 indexes per triangle
+	static const unsigned int StripIndexCount = 6*5; // 6 faces, triangle strip with 4 indexes plus restart index each
+
+	/*! Fills in the indexes for drawing the box as triangle strips instead of the triangles written by copy2Buffer().
+		Each face becomes a strip of 2 triangles, followed by the primitive restart index ElementBatches::RestartIndex.
+		The vertex data written by copy2Buffer() is used unchanged.
+		elementStartIndex is the index of the first vertex of the box, and is advanced by VertexCount.
+	*/
+	static void copyStripElements2Buffer(GLuint * & elementBuffer, unsigned int & elementStartIndex);
+
+	static const unsigned int CornerVertexCount = 8; // 8 corners shared by all faces, see copy2CornerBuffer()
+
+	/*! Index of the face whose color is stored in a corner, -1 for the 2 corners that do not carry a face color. */
+	static const int CornerFaces[8];
 
 	/*! Tests if line in space, defined through starting point p1 and distance/direction d intersects the plane
 		with index planeIdx.
+		Uses the precomputed face data in m_planeInfo, unless compiled with LEGACY_RECT_TEST, in which
+		case intersectsLegacy() is used.
 	*/
 	bool intersects(unsigned int planeIdx, const QVector3D & p1, const QVector3D & d, float & dist) const;
 
-private:
+	/*! Same as intersects(), but uses the general intersectsRect() function. */
+	bool intersectsLegacy(unsigned int planeIdx, const QVector3D & p1, const QVector3D & d, float & dist) const;
+
+	/*! Computes the axis-aligned bounding box of the box (minimum and maximum corner). */
+	void boundingBox(QVector3D & minCorner, QVector3D & maxCorner) const;
+
+	/*! Returns the colors of all 6 faces. */
+	void faceColors(QRgb cols[6]) const;
+
+	/*! The 8 vertexes (corners) of the box. */
+	const std::vector<QVector3D> & vertices() const { return m_vertices; }
+	/*! Approximate memory used by the box including heap memory (without allocator overhead), in bytes. */
+	size_t memSize() const {
+		return sizeof(BoxMesh) + m_vertices.capacity()*sizeof(QVector3D) + m_planeInfo.capacity()*sizeof(Rect)
+				+ m_colors.capacity()*sizeof(QColor);
+	}
+
+	/*! A face, spanned by vectors m_a and m_b from point m_offset. */
 	struct Rect {
 		Rect(){}
 		Rect(QVector3D a, QVector3D b, QVector3D d);
@@ -73,9 +110,46 @@ private:
 		QVector3D m_offset;
 		QVector3D m_a;
 		QVector3D m_b;
+		// Precomputed data for intersects(): for a point x on the plane, the local
+		// coordinates are u = (x - m_offset)*m_u and v = (x - m_offset)*m_v.
+		QVector3D m_n;		// m_a x m_b, not normalized
+		QVector3D m_u;		// (m_b x m_n)/|m_n|^2
+		QVector3D m_v;		// (m_n x m_a)/|m_n|^2
 	};
+
+	/*! The 6 faces of the box. */
+	const std::vector<Rect> & planeInfo() const { return m_planeInfo; }
+
+	// The functions below implement the member functions above for box data stored elsewhere (see BoxStore),
+	// given as 8 vertexes (corners), 6 faces and 6 face colors.
+
+	/*! Computes the 8 vertexes of the axis-aligned box with given center and dimensions (same order as in the constructor). */
+	static void boxVertices(const QVector3D & center, const QVector3D & size, QVector3D * vertices);
+	/*! Computes the 6 faces from the 8 vertexes. */
+	static void updatePlaneInfo(const QVector3D * vertices, Rect * planeInfo);
+	static bool intersects(const Rect & r, const QVector3D & p1, const QVector3D & d, float & dist);
+	static bool intersectsLegacy(const Rect & r, const QVector3D & p1, const QVector3D & d, float & dist);
+	static void boundingBox(const QVector3D * vertices, QVector3D & minCorner, QVector3D & maxCorner);
+	static void copy2Buffer(const QVector3D * vertices, const QRgb * faceColors,
+							VertexPNC * & vertexBuffer, GLuint * & elementBuffer, unsigned int & elementStartIndex);
+	static void copy2InstanceBuffer(const QVector3D * vertices, const QRgb * faceColors, BoxInstance & instance);
+	/*! Fills in the 8 corners of the box, for drawing the box with shared corners instead of 24 vertexes.
+		Each face gets a different corner, that holds the face color (see CornerFaces). The indexes written by
+		copyCornerElements2Buffer() make this corner the last vertex of both face triangles, which is the
+		provoking vertex for 'flat' shader outputs. Normals are not stored, the fragment shader computes them.
+	*/
+	static void copy2CornerBuffer(const QVector3D * vertices, const QRgb * faceColors, VertexPC * & vertexBuffer);
+	/*! Fills in the IndexCount indexes for the corners written by copy2CornerBuffer(), with the same winding
+		as in copy2Buffer(). elementStartIndex is the index of the first corner, and is advanced by CornerVertexCount.
+	*/
+	static void copyCornerElements2Buffer(GLuint * & elementBuffer, unsigned int & elementStartIndex);
+
+private:
+	/*! Computes m_planeInfo from m_vertices. */
+	void updatePlaneInfo();
+
 	std::vector<QVector3D>	m_vertices;
-	std::vector<Rect>		m_planeInfo; // populated in copy2Buffer
+	std::vector<Rect>		m_planeInfo; // updated whenever m_vertices change
 	std::vector<QColor>		m_colors;	// size 1 = uniform color, size 6 = face colors
 };
 
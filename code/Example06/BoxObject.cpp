@@ -14,13 +14,51 @@ License    : BSD License,
 #include <QVector3D>
 #include <QOpenGLShaderProgram>
 #include <QElapsedTimer>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QStandardPaths>
+#include <QDir>
 
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <random>
+
+#include "DepthPyramid.h"
+#include "Frustum.h"
+#include "MeshOptimizer.h"
+#include "Parallel.h"
 #include "PickObject.h"
 
 BoxObject::BoxObject() :
+	m_generation(0),
+	m_renderMode(RM_Vertexes),
+	m_triangleStrips(false),
+	m_frustumCulling(true),
+	m_gpuCulling(true),
+	m_drawnChunks(0),
+	m_culledChunks(0),
+	m_occludedChunks(0),
+	m_levelOfDetail(false),
+	m_lodCulledTiles(0),
+	m_lodTriangles(0),
+	m_pickMethod(PM_BVH),
+	m_pickChunkSize(2048),
+	m_bvhRebuildThreshold(1.3f),
 	m_vbo(QOpenGLBuffer::VertexBuffer), // actually the default, so default constructor would have been enough
-	m_ebo(QOpenGLBuffer::IndexBuffer) // make this an Index Buffer
+	m_ebo(QOpenGLBuffer::IndexBuffer), // make this an Index Buffer
+	m_instanceVbo(QOpenGLBuffer::VertexBuffer),
+	m_bufferBoxCapacity(0),
+	m_chunkBoundsDirty(true),
+	m_gpuCullingDirty(true),
+	m_shaderProgram(nullptr),
+	m_lodVbo(QOpenGLBuffer::VertexBuffer),
+	m_lodEbo(QOpenGLBuffer::IndexBuffer),
+	m_lodGeneration(0)
 {
+	std::fill(m_lodTiles, m_lodTiles + BoxLOD::NUM_L, 0);
+
 	Transform3D trans;
 #if 1
 	// create coordinate system boxes
@@ -65,82 +103,280 @@ BoxObject::BoxObject() :
 	for (unsigned int i=0; i<GridDim; ++i)
 		for (unsigned int j=0; j<GridDim; ++j)
 			boxPerCells[i][j] = 0;
+	// Box placement depends on the sequence of random numbers and on the number of boxes already placed
+	// in a cell, so it is determined serially (this is cheap), to get the same scene as always.
+	// Mind: the random numbers are taken from a generator with a fixed seed (and not from the time-seeded
+	// qrand()), so that the scene is the same with each start and the scene cache below can be used.
+	std::mt19937 randomNumbers(1);
+	std::uniform_int_distribution<int> gridCell(0, GridDim - 1);
+	QElapsedTimer t;
+	t.start();
+	const float boxHeight = 4.5;
+	std::vector<QVector3D> translations(BoxGenCount);
 	for (unsigned int i=0; i<BoxGenCount; ++i) {
 		// create other boxes in randomize grid, x and z dimensions fixed, height varies discretely
 		// x and z translation in a grid that has dimension 'GridDim' with 5 space units as grid (line) spacing
-		int xGrid = qrand()*double(GridDim)/RAND_MAX;
-		int zGrid = qrand()*double(GridDim)/RAND_MAX;
+		int xGrid = gridCell(randomNumbers);
+		int zGrid = gridCell(randomNumbers);
 		int boxCount = boxPerCells[xGrid][zGrid]++;
-		float boxHeight = 4.5;
-		BoxMesh b(4,boxHeight,3);
-//		b.setFaceColors({Qt::blue, Qt::red, Qt::yellow, Qt::green, Qt::magenta, Qt::darkCyan});
-//		b.setColor(QColor("#ffffe6"));
-		std::vector<QColor> c = {QColor("#ffffe6"), QColor("#ffffe6"), QColor("#ffffe6"), QColor("#ffffe6"), QColor("#000040"), QColor("#800000")};
-//		c.push_back(QColor("#ffffe6"));
-//		c.push_back(QColor("#ffffe6"));
-//		c.push_back(QColor("#ffffe6"));
-//		c.push_back(QColor("#ffffe6"));
-//		c.push_back(QColor("#080000"));
-//		c.push_back(QColor("#080000"));
-		b.setFaceColors(c);
-		trans.setTranslation((-GridDim/2+xGrid)*BoxGridSize, boxCount*BoxGridSize + 0.5*boxHeight, (-GridDim/2 + zGrid)*BoxGridSize);
-		b.transform(trans.toMatrix());
-		m_boxes.push_back(b);
+		translations[i] = QVector3D((-GridDim/2+xGrid)*BoxGridSize, boxCount*BoxGridSize + 0.5*boxHeight, (-GridDim/2 + zGrid)*BoxGridSize);
 	}
 
-	unsigned int NBoxes = m_boxes.size();
+	// Draw boxes close to each other one after another (Morton order). Neighboring boxes then cover
+	// each other mostly within the same draw batch, and the depth test rejects hidden fragments more often
+	// before they are shaded, compared to the random placement order.
+	std::vector<unsigned int> order = mortonOrder(translations);
+	std::vector<QVector3D> sortedTranslations(BoxGenCount);
+	for (unsigned int i=0; i<BoxGenCount; ++i)
+		sortedTranslations[i] = translations[order[i]];
+	translations.swap(sortedTranslations);
+
+	const float boxDims[3] = {4, boxHeight, 3};
+	const std::vector<QColor> faceColors = {QColor("#ffffe6"), QColor("#ffffe6"), QColor("#ffffe6"), QColor("#ffffe6"), QColor("#000040"), QColor("#800000")};
+
+	// The generated scene is determined by the boxes created so far, the box translations, dimensions and
+	// colors. If the scene cache was written for the same input, we take the box data from the cache instead.
+	// Mind: when changing the box generation below, add all new parameters to the hash.
+	quint64 contentHash = SceneCache::hash(m_boxes.m_vertices.data(), m_boxes.m_vertices.size()*sizeof(QVector3D));
+	contentHash = SceneCache::hash(m_boxes.m_colors.data(), m_boxes.m_colors.size()*sizeof(QRgb), contentHash);
+	contentHash = SceneCache::hash(translations.data(), translations.size()*sizeof(QVector3D), contentHash);
+	contentHash = SceneCache::hash(boxDims, sizeof(boxDims), contentHash);
+	for (const QColor & c : faceColors) {
+		QRgb rgba = c.rgba();
+		contentHash = SceneCache::hash(&rgba, sizeof(rgba), contentHash);
+	}
+	QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+	QString cacheFile = cacheDir + "/boxes.scenecache";
+	t.start();
+	if (m_sceneCache.open(cacheFile, contentHash)) {
+		// m_vertexBufferData remains empty, the vertex buffer is filled directly from the mapped file in create()
+		m_sceneCache.read(m_boxes, m_elementBufferData, m_instanceBufferData);
+		qDebug() << "BoxObject -" << m_sceneCache.boxCount() << "boxes loaded from scene cache" << cacheFile << "in" << t.elapsed() << "ms";
+	}
+	else {
+		generateBoxes(translations, boxDims, faceColors);
+		qDebug() << "BoxObject -" << BoxGenCount << "boxes generated in" << t.elapsed() << "ms";
+		t.start();
+		if (QDir().mkpath(cacheDir) &&
+			SceneCache::write(cacheFile, contentHash, m_boxes, m_vertexBufferData, m_elementBufferData, m_instanceBufferData))
+		{
+			qDebug() << "BoxObject - Scene cache" << cacheFile << "written in" << t.elapsed() << "ms";
+		}
+	}
+
+	// keep the lattice as spatial index for picking; the lattice cells are centered around the box positions
+	// and stack upwards, with one box per cell
+	t.start();
+	int maxBoxesPerCell = 0;
+	for (unsigned int i=0; i<GridDim; ++i)
+		for (unsigned int j=0; j<GridDim; ++j)
+			maxBoxesPerCell = qMax(maxBoxesPerCell, boxPerCells[i][j]);
+	m_grid.setup(QVector3D((-GridDim/2 - 0.5f)*BoxGridSize, 0, (-GridDim/2 - 0.5f)*BoxGridSize),
+				 QVector3D(BoxGridSize, BoxGridSize, BoxGridSize), GridDim, maxBoxesPerCell, GridDim);
+	for (unsigned int i=0; i<m_boxes.size(); ++i) {
+		QVector3D minCorner, maxCorner;
+		m_boxes.boundingBox(i, minCorner, maxCorner);
+		m_grid.insert(i, minCorner, maxCorner);
+	}
+	qDebug() << "BoxObject - Grid with" << GridDim << "x" << maxBoxesPerCell << "x" << GridDim << "cells built in" << t.elapsed() << "ms,"
+			 << m_grid.m_unalignedBoxIds.size() << "boxes outside lattice";
+
+	// create acceleration structures for picking
+	updateBVH();
+	updateBoxBounds();
+}
+
+
+void BoxObject::generateBoxes(const std::vector<QVector3D> & translations, const float boxDims[3],
+							  const std::vector<QColor> & faceColors)
+{
+	unsigned int firstGenBox = m_boxes.size();
+	unsigned int NBoxes = firstGenBox + translations.size();
+	m_boxes.resize(NBoxes);
 
 	// resize storage arrays
 	m_vertexBufferData.resize(NBoxes*BoxMesh::VertexCount);
 	m_elementBufferData.resize(NBoxes*BoxMesh::IndexCount);
+	// instance data is tiny compared to the vertex data, so we always keep it
+	m_instanceBufferData.resize(NBoxes);
 
-	// update the buffers
-	VertexVNC * vertexBuffer = m_vertexBufferData.data();
+	// update the buffers for the boxes created so far
+	VertexPNC * vertexBuffer = m_vertexBufferData.data();
 	unsigned int vertexCount = 0;
 	GLuint * elementBuffer = m_elementBufferData.data();
-	for (const BoxMesh & b : m_boxes)
-		b.copy2Buffer(vertexBuffer, elementBuffer, vertexCount);
+	for (unsigned int i=0; i<firstGenBox; ++i) {
+		m_boxes.copy2Buffer(i, vertexBuffer, elementBuffer, vertexCount);
+		m_boxes.copy2InstanceBuffer(i, m_instanceBufferData[i]);
+	}
+
+	// Generate meshes and fill buffers in parallel. The slots of each box in m_boxes and the buffers
+	// are known, so that the threads can write in place without synchronization.
+	const unsigned int GenChunkSize = 1024;
+	auto generateChunk = [this, &translations, boxDims, &faceColors, firstGenBox, GenChunkSize](unsigned int chunk) {
+		unsigned int last = qMin<unsigned int>((chunk + 1)*GenChunkSize, translations.size());
+		Transform3D trans;
+		for (unsigned int i=chunk*GenChunkSize; i<last; ++i) {
+			unsigned int boxId = firstGenBox + i;
+			BoxMesh b(boxDims[0], boxDims[1], boxDims[2]);
+			b.setFaceColors(faceColors);
+			trans.setTranslation(translations[i]);
+			b.transform(trans.toMatrix());
+
+			VertexPNC * vertexBuffer = m_vertexBufferData.data() + boxId*BoxMesh::VertexCount;
+			unsigned int vertexCount = boxId*BoxMesh::VertexCount;
+			GLuint * elementBuffer = m_elementBufferData.data() + boxId*BoxMesh::IndexCount;
+			b.copy2Buffer(vertexBuffer, elementBuffer, vertexCount);
+			b.copy2InstanceBuffer(m_instanceBufferData[boxId]);
+			m_boxes.set(boxId, b);
+		}
+	};
+	processChunksInParallel((translations.size() + GenChunkSize - 1)/GenChunkSize, generateChunk);
 }
 
 
 void BoxObject::create(QOpenGLShaderProgram * shaderProgramm) {
+	m_shaderProgram = shaderProgramm;
+
 	// create and bind Vertex Array Object
 	m_vao.create();
 	m_vao.bind();
 
+	// in instanced mode, the vertex and element buffers only hold a single unit cube
+	std::vector<VertexPNC> unitCubeVertexes;
+	std::vector<GLuint> unitCubeElements;
+	// in shared corners mode, the vertex buffer holds 8 corners per box
+	std::vector<VertexPC> cornerVertexes;
+	const void * vertexData = m_vertexBufferData.data();
+	// as long as the box data was not modified after loading from the scene cache, the vertex data is
+	// uploaded directly from the mapped cache file
+	if (m_sceneCache.isOpen())
+		vertexData = m_sceneCache.vertexes();
+	unsigned int vertexSize = sizeof(VertexPNC);
+	std::vector<GLuint> * elementData = &m_elementBufferData;
+	unsigned int vertexCount = m_boxes.size()*BoxMesh::VertexCount;
+	if (m_renderMode == RM_SharedCorners) {
+		cornerBufferData(cornerVertexes);
+		vertexData = cornerVertexes.data();
+		vertexSize = sizeof(VertexPC);
+		vertexCount = cornerVertexes.size();
+	}
+	else if (m_renderMode == RM_Instanced) {
+		unitCubeVertexes.resize(BoxMesh::VertexCount);
+		unitCubeElements.resize(BoxMesh::IndexCount);
+		VertexPNC * vertexBuffer = unitCubeVertexes.data();
+		GLuint * elementBuffer = unitCubeElements.data();
+		unsigned int startIndex = 0;
+		BoxMesh(1,1,1).copy2Buffer(vertexBuffer, elementBuffer, startIndex);
+		vertexData = unitCubeVertexes.data();
+		elementData = &unitCubeElements;
+		vertexCount = BoxMesh::VertexCount;
+	}
+
 	// create and bind vertex buffer
 	m_vbo.create();
 	m_vbo.bind();
 	m_vbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
-	int vertexMemSize = m_vertexBufferData.size()*sizeof(VertexVNC);
-	qDebug() << "BoxObject - VertexBuffer size =" << vertexMemSize/1024.0 << "kByte";
-	m_vbo.allocate(m_vertexBufferData.data(), vertexMemSize);
+	int vertexMemSize = vertexCount*vertexSize;
+	QElapsedTimer t;
+	t.start();
+	m_vbo.allocate(vertexData, vertexMemSize);
+	if (m_renderMode == RM_SharedCorners)
+		qDebug() << "BoxObject - VertexBuffer size =" << vertexMemSize/1024.0 << "kByte (" << m_boxes.size()*BoxMesh::VertexCount*sizeof(VertexPNC)/1024.0
+				 << "kByte with 24 vertexes per box), uploaded in" << t.nsecsElapsed()*1e-6 << "ms";
+	else
+		qDebug() << "BoxObject - VertexBuffer size =" << vertexMemSize/1024.0 << "kByte (" << vertexCount*sizeof(VertexVNC)/1024.0
+				 << "kByte with unpacked vertexes), uploaded in" << t.nsecsElapsed()*1e-6 << "ms";
 
 	// create and bind element buffer
 	m_ebo.create();
 	m_ebo.bind();
 	m_ebo.setUsagePattern(QOpenGLBuffer::StaticDraw);
-	int elementMemSize = m_elementBufferData.size()*sizeof(GLuint);
+	if (m_renderMode == RM_SharedCorners) {
+		setupCornerElementBatches(m_boxes.size());
+	}
+	else if (m_triangleStrips) {
+		// the triangle order within a strip is fixed, so there is nothing to optimize for the vertex cache
+		setupStripElementBatches(vertexCount/BoxMesh::VertexCount);
+	}
+	else {
+		// box faces share no vertexes, so the two triangles per face are already in optimal order (ACMR 2);
+		// the element data is kept in the order written by BoxStore::copy2Buffer(), which highlight() and
+		// setupElementBatches() rely on
+		qDebug() << "BoxObject - Vertex cache: ACMR" << averageCacheMissRatio(elementData->data(), elementData->size());
+		m_elementBatches.setup(*elementData, BoxMesh::VertexCount, BoxMesh::IndexCount);
+	}
+	int elementMemSize = m_elementBatches.memSize();
 	qDebug() << "BoxObject - ElementBuffer size =" << elementMemSize/1024.0 << "kByte";
-	m_ebo.allocate(m_elementBufferData.data(), elementMemSize);
+	m_elementBatches.allocate(m_ebo);
 
 	// set shader attributes
 	// tell shader program we have two data arrays to be used as input to the shaders
 
 	// index 0 = position
 	shaderProgramm->enableAttributeArray(0); // array with index/id 0
-	shaderProgramm->setAttributeBuffer(0, GL_FLOAT, 0, 3, sizeof(VertexVNC));
-	// index 1 = normal
-	shaderProgramm->enableAttributeArray(1); // array with index/id 1
-	shaderProgramm->setAttributeBuffer(1, GL_FLOAT, offsetof(VertexVNC, m), 3, sizeof(VertexVNC));
-	// index 2 = color
-	shaderProgramm->enableAttributeArray(2); // array with index/id 2
-	shaderProgramm->setAttributeBuffer(2, GL_FLOAT, offsetof(VertexVNC, r), 3, sizeof(VertexVNC));
+	shaderProgramm->setAttributeBuffer(0, GL_FLOAT, 0, 3, vertexSize);
+
+	// index 1 = normal, packed into one integer; mind: packed formats always have 4 components
+	// (shared corners have no normals)
+	if (m_renderMode != RM_SharedCorners) {
+		shaderProgramm->enableAttributeArray(1); // array with index/id 1
+		shaderProgramm->setAttributeBuffer(1, GL_INT_2_10_10_10_REV, offsetof(VertexPNC, n), 4, sizeof(VertexPNC));
+	}
+
+	if (m_renderMode != RM_Instanced) {
+		// index 2 = color, bytes are normalized to 0..1 by OpenGL
+		shaderProgramm->enableAttributeArray(2); // array with index/id 2
+		shaderProgramm->setAttributeBuffer(2, GL_UNSIGNED_BYTE, m_renderMode == RM_SharedCorners ? offsetof(VertexPC, r) : offsetof(VertexPNC, r),
+										   4, vertexSize);
+	}
+	else {
+		// create and bind instance buffer; attributes are taken from this buffer, while it is bound
+		m_instanceVbo.create();
+		m_instanceVbo.bind();
+		m_instanceVbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+		int instanceMemSize = m_instanceBufferData.size()*sizeof(BoxInstance);
+		qDebug() << "BoxObject - InstanceBuffer size =" << instanceMemSize/1024.0 << "kByte, total"
+				 << (vertexMemSize + elementMemSize + instanceMemSize)/1024.0 << "kByte instead of"
+				 << m_boxes.size()*(BoxMesh::VertexCount*sizeof(VertexPNC) + BoxMesh::IndexCount*sizeof(GLuint))/1024.0 << "kByte";
+		m_instanceVbo.allocate(m_instanceBufferData.data(), instanceMemSize);
+
+		// index 3 = translation, index 4 = scale, index 5..10 = face colors (bytes, normalized to 0..1 by OpenGL)
+		shaderProgramm->enableAttributeArray(3);
+		shaderProgramm->setAttributeBuffer(3, GL_FLOAT, offsetof(BoxInstance, x), 3, sizeof(BoxInstance));
+		shaderProgramm->enableAttributeArray(4);
+		shaderProgramm->setAttributeBuffer(4, GL_FLOAT, offsetof(BoxInstance, sx), 3, sizeof(BoxInstance));
+		for (int i=0; i<6; ++i) {
+			shaderProgramm->enableAttributeArray(5 + i);
+			shaderProgramm->setAttributeBuffer(5 + i, GL_UNSIGNED_BYTE, offsetof(BoxInstance, colors) + i*4, 4, sizeof(BoxInstance));
+		}
+		// advance these attributes once per box instead of once per vertex
+		QOpenGLExtraFunctions * f = QOpenGLContext::currentContext()->extraFunctions();
+		for (int i=3; i<=10; ++i)
+			f->glVertexAttribDivisor(i, 1);
+	}
 
 	// Release (unbind) all
 	m_vao.release();
 	m_vbo.release();
 	m_ebo.release();
+	if (m_renderMode == RM_Instanced)
+		m_instanceVbo.release();
+	m_bufferBoxCapacity = m_boxes.size();
+
+	// instanced boxes are identified by gl_InstanceID in the shaders, which is not affected by indirect draws
+	// with base instance, so GPU culling is only used for the other render modes
+	// the compute shader is checked against the culling on the CPU once, GPU culling is only used if both agree
+	if (m_renderMode != RM_Instanced && GPUCulling::isSupported()) {
+		if (m_gpuCuller.create()) {
+			if (verifyGPUCulling())
+				qDebug() << "BoxObject - GPU culling with compute shader and indirect draws available";
+			else {
+				qWarning() << "BoxObject - GPU culling results differ from culling on the CPU, GPU culling disabled";
+				m_gpuCuller.destroy();
+			}
+		}
+		m_gpuCullingDirty = true;
+	}
 }
 
 
@@ -148,29 +384,637 @@ void BoxObject::destroy() {
 	m_vao.destroy();
 	m_vbo.destroy();
 	m_ebo.destroy();
+	m_instanceVbo.destroy();
+	m_gpuCuller.destroy();
+	m_lodVao.destroy();
+	m_lodVbo.destroy();
+	m_lodEbo.destroy();
 }
 
 
-void BoxObject::render() {
+void BoxObject::render(QOpenGLTimeMonitor * batchTimers, const Frustum * frustum, const DepthPyramid * occluders) {
 	// set the geometry ("position", "normal" and "color" arrays)
 	m_vao.bind();
 
 	// now draw the cube by drawing individual triangles
 	// - GL_TRIANGLES - draw individual triangles via elements
-	glDrawElements(GL_TRIANGLES, m_elementBufferData.size(), GL_UNSIGNED_INT, nullptr);
+	if (m_renderMode == RM_Instanced) {
+		if (m_triangleStrips)
+			glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+		QOpenGLContext::currentContext()->extraFunctions()->glDrawElementsInstanced(m_elementBatches.m_primitiveType,
+																					 m_elementBatches.m_indexesPerObject,
+																					 m_elementBatches.indexType(), nullptr, m_boxes.size());
+		if (m_triangleStrips)
+			glDisable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+	}
+	else if (frustum != nullptr && m_frustumCulling && m_gpuCulling && m_gpuCuller.isCreated() && occluders == nullptr) {
+		if (m_chunkBoundsDirty)
+			updateChunkBounds();
+		if (m_gpuCullingDirty) {
+			m_gpuCuller.setup(m_chunkBounds, CullChunkSize, m_boxes.size(), m_elementBatches);
+			m_gpuCullingDirty = false;
+		}
+		m_gpuCuller.draw(*frustum, m_elementBatches);
+	}
+	else if (frustum != nullptr && m_frustumCulling) {
+		cullChunks(*frustum, occluders);
+		m_elementBatches.drawRanges(m_drawRanges);
+	}
+	else
+		m_elementBatches.draw(m_boxes.size(), batchTimers);
 	// release vertices again
 	m_vao.release();
 }
 
 
+/*! Sorts the ranges and merges ranges that follow each other without gap. */
+static void mergeRanges(std::vector<ElementBatches::Range> & ranges) {
+	std::sort(ranges.begin(), ranges.end(), [](const ElementBatches::Range & a, const ElementBatches::Range & b) {
+		return a.m_first < b.m_first;
+	});
+	unsigned int merged = 0;
+	for (unsigned int i=1; i<ranges.size(); ++i) {
+		if (ranges[merged].m_first + ranges[merged].m_count == ranges[i].m_first)
+			ranges[merged].m_count += ranges[i].m_count;
+		else
+			ranges[++merged] = ranges[i];
+	}
+	if (!ranges.empty())
+		ranges.resize(merged + 1);
+}
+
+
+void BoxObject::renderLevelsOfDetail(const QVector3D & viewPos, const Frustum & frustum, int hoverBoxIdLocation,
+									 const DepthPyramid * occluders)
+{
+	Q_ASSERT(m_renderMode == RM_Vertexes);
+	if (!m_lodVao.isCreated() || m_lodGeneration != m_generation)
+		updateLevelsOfDetail();
+	m_lod.selectLevels(viewPos);
+
+	// visible tiles
+	if (m_frustumCulling)
+		boxesInFrustum(m_lod.m_tileBounds, frustum, m_visibleTiles);
+	else {
+		m_visibleTiles.resize(m_lod.m_tiles.size());
+		for (unsigned int i=0; i<m_visibleTiles.size(); ++i)
+			m_visibleTiles[i] = i;
+	}
+	if (occluders != nullptr) {
+		auto hidden = [this, occluders](unsigned int tileId) {
+			const BoxBounds & b = m_lod.m_tileBounds;
+			return occluders->isOccluded(QVector3D(b.m_minX[tileId], b.m_minY[tileId], b.m_minZ[tileId]),
+										 QVector3D(b.m_maxX[tileId], b.m_maxY[tileId], b.m_maxZ[tileId]));
+		};
+		m_visibleTiles.erase(std::remove_if(m_visibleTiles.begin(), m_visibleTiles.end(), hidden), m_visibleTiles.end());
+	}
+	m_lodCulledTiles = m_lod.m_tiles.size() - m_visibleTiles.size();
+
+	// collect boxes and proxies of the visible tiles
+	m_drawRanges.clear();
+	m_lodDrawRanges.clear();
+	std::fill(m_lodTiles, m_lodTiles + BoxLOD::NUM_L, 0);
+	unsigned int objectCount = 0;
+	for (unsigned int tileId : m_visibleTiles) {
+		const BoxLOD::Tile & tile = m_lod.m_tiles[tileId];
+		++m_lodTiles[tile.m_level];
+		if (tile.m_level == BoxLOD::L_Boxes) {
+			m_drawRanges.insert(m_drawRanges.end(), tile.m_boxRanges.begin(), tile.m_boxRanges.end());
+			objectCount += tile.m_boxCount;
+		}
+		else if (tile.m_proxies[tile.m_level].m_count > 0) {
+			m_lodDrawRanges.push_back(tile.m_proxies[tile.m_level]);
+			objectCount += tile.m_proxies[tile.m_level].m_count;
+		}
+	}
+	m_lodTriangles = objectCount*BoxMesh::IndexCount/3;
+	// boxes of neighboring tiles are often consecutive (Morton order), so they can be drawn with few calls
+	mergeRanges(m_drawRanges);
+	mergeRanges(m_lodDrawRanges);
+
+	m_vao.bind();
+	m_elementBatches.drawRanges(m_drawRanges);
+	m_vao.release();
+
+	// proxies are not pickable, hence no hover highlighting (the shader derives the box index from gl_VertexID)
+	m_shaderProgram->setUniformValue(hoverBoxIdLocation, -1);
+	m_lodVao.bind();
+	m_lodBatches.drawRanges(m_lodDrawRanges);
+	m_lodVao.release();
+}
+
+
 void BoxObject::pick(const QVector3D & p1, const QVector3D & d, PickObject & po) const {
+	switch (m_pickMethod) {
+		case PM_BruteForce	: pickBruteForce(p1, d, po); break;
+		case PM_BVH			: pickBVH(p1, d, po); break;
+		case PM_Grid		: pickGrid(p1, d, po); break;
+		case PM_SlabTest	: pickSlabTest(p1, d, po); break;
+		case PM_Parallel	: pickParallel(p1, d, po); break;
+		case NUM_PM			: ;
+	}
+}
+
+
+void BoxObject::updateBVH() {
+	QElapsedTimer t;
+	t.start();
+
+	std::vector<QVector3D> minCorners(m_boxes.size());
+	std::vector<QVector3D> maxCorners(m_boxes.size());
+	for (unsigned int i=0; i<m_boxes.size(); ++i)
+		m_boxes.boundingBox(i, minCorners[i], maxCorners[i]);
+	m_bvh.build(minCorners, maxCorners);
+
+	qDebug() << "BoxObject - BVH with" << m_bvh.m_nodes.size() << "nodes built in" << t.elapsed() << "ms";
+}
+
+
+/*! Builds a bounding volume hierarchy, used for background rebuilds. */
+static BoxBVH buildBVH(std::vector<QVector3D> minCorners, std::vector<QVector3D> maxCorners) {
+	BoxBVH bvh;
+	bvh.build(minCorners, maxCorners);
+	return bvh;
+}
+
+
+void BoxObject::pollBVHRebuild() {
+	if (!m_bvhRebuild.valid() || m_bvhRebuild.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		return;
+
+	float oldDegradation = m_bvh.degradation();
+	m_bvh = m_bvhRebuild.get();
+
+	// the new tree was built from the box geometry at the start of the rebuild, so apply all modifications since then
+	std::sort(m_bvhModifiedBoxes.begin(), m_bvhModifiedBoxes.end());
+	m_bvhModifiedBoxes.erase(std::unique(m_bvhModifiedBoxes.begin(), m_bvhModifiedBoxes.end()), m_bvhModifiedBoxes.end());
+	for (unsigned int boxId : m_bvhModifiedBoxes) {
+		bool exists = boxId < m_boxes.size();
+		if (exists) {
+			QVector3D minCorner, maxCorner;
+			m_boxes.boundingBox(boxId, minCorner, maxCorner);
+			if (m_bvh.contains(boxId))
+				m_bvh.update(boxId, minCorner, maxCorner);
+			else
+				m_bvh.insert(boxId, minCorner, maxCorner);
+		}
+		else if (m_bvh.contains(boxId))
+			m_bvh.remove(boxId);
+	}
+	qDebug() << "BoxObject - BVH rebuilt in background, degradation" << oldDegradation << "->" << m_bvh.degradation()
+			 << "," << m_bvhModifiedBoxes.size() << "boxes modified during rebuild";
+	m_bvhModifiedBoxes.clear();
+}
+
+
+void BoxObject::checkBVHQuality() {
+	if (m_bvhRebuild.valid() || m_bvh.degradation() <= m_bvhRebuildThreshold)
+		return;
+
+	// the rebuild works on a copy of the bounding boxes, so that boxes can be modified meanwhile
+	std::vector<QVector3D> minCorners(m_boxes.size());
+	std::vector<QVector3D> maxCorners(m_boxes.size());
+	for (unsigned int i=0; i<m_boxes.size(); ++i)
+		m_boxes.boundingBox(i, minCorners[i], maxCorners[i]);
+	m_bvhRebuild = std::async(std::launch::async, buildBVH, std::move(minCorners), std::move(maxCorners));
+	qDebug() << "BoxObject - BVH degradation" << m_bvh.degradation() << ", starting rebuild in background";
+}
+
+
+void BoxObject::bvhBoxModified(unsigned int boxId) {
+	if (m_bvhRebuild.valid())
+		m_bvhModifiedBoxes.push_back(boxId);
+}
+
+
+void BoxObject::transformBox(unsigned int boxId, const QMatrix4x4 & transform) {
+	QVector3D oldMin, oldMax;
+	m_boxes.boundingBox(boxId, oldMin, oldMax);
+	m_boxes.transform(boxId, transform);
+	++m_generation;
+	QVector3D minCorner, maxCorner;
+	m_boxes.boundingBox(boxId, minCorner, maxCorner);
+
+	m_boxBounds.set(boxId, minCorner, maxCorner);
+	m_chunkBoundsDirty = true;
+	m_grid.remove(boxId, oldMin, oldMax);
+	m_grid.insert(boxId, minCorner, maxCorner);
+	m_bvh.update(boxId, minCorner, maxCorner);
+	bvhBoxModified(boxId);
+	checkBVHQuality();
+
+	updateBoxBuffers(boxId);
+}
+
+
+unsigned int BoxObject::addBox(const BoxMesh & box) {
+	BoxStore boxes;
+	boxes.push_back(box);
+	return appendBoxes(boxes);
+}
+
+
+unsigned int BoxObject::appendBoxes(const BoxStore & boxes) {
+	releaseSceneCache();
+	unsigned int firstBox = m_boxes.size();
+	if (boxes.size() == 0)
+		return firstBox;
+	m_boxes.append(boxes);
+	unsigned int NBoxes = m_boxes.size();
+	++m_generation;
+
+	m_boxBounds.resize(NBoxes);
+	for (unsigned int boxId=firstBox; boxId<NBoxes; ++boxId) {
+		QVector3D minCorner, maxCorner;
+		m_boxes.boundingBox(boxId, minCorner, maxCorner);
+		m_boxBounds.set(boxId, minCorner, maxCorner);
+		m_grid.insert(boxId, minCorner, maxCorner);
+		m_bvh.insert(boxId, minCorner, maxCorner);
+		bvhBoxModified(boxId);
+	}
+	m_chunkBoundsDirty = true;
+	checkBVHQuality();
+
+	// fill buffer data of the new boxes in parallel, the slots of each box are known
+	m_vertexBufferData.resize(NBoxes*BoxMesh::VertexCount);
+	m_elementBufferData.resize(NBoxes*BoxMesh::IndexCount);
+	m_instanceBufferData.resize(NBoxes);
+	const unsigned int CopyChunkSize = 4096;
+	auto copyChunk = [this, firstBox, NBoxes, CopyChunkSize](unsigned int chunk) {
+		unsigned int last = qMin(firstBox + (chunk + 1)*CopyChunkSize, NBoxes);
+		for (unsigned int boxId=firstBox + chunk*CopyChunkSize; boxId<last; ++boxId) {
+			VertexPNC * vertexBuffer = m_vertexBufferData.data() + boxId*BoxMesh::VertexCount;
+			unsigned int vertexCount = boxId*BoxMesh::VertexCount;
+			GLuint * elementBuffer = m_elementBufferData.data() + boxId*BoxMesh::IndexCount;
+			m_boxes.copy2Buffer(boxId, vertexBuffer, elementBuffer, vertexCount);
+			m_boxes.copy2InstanceBuffer(boxId, m_instanceBufferData[boxId]);
+		}
+	};
+	processChunksInParallel((NBoxes - firstBox + CopyChunkSize - 1)/CopyChunkSize, copyChunk);
+
+	// only the new boxes need to be written, unless the buffers need to grow
+	if (NBoxes <= m_bufferBoxCapacity)
+		writeBoxBuffer(firstBox, NBoxes - 1);
+	else
+		reallocateBoxBuffers(qMax(NBoxes, 2*m_bufferBoxCapacity));
+	return firstBox;
+}
+
+
+void BoxObject::removeBox(unsigned int boxId) {
+	releaseSceneCache();
+	unsigned int lastBoxId = m_boxes.size() - 1;
+	++m_generation;
+	QVector3D minCorner, maxCorner;
+	m_boxes.boundingBox(boxId, minCorner, maxCorner);
+	m_grid.remove(boxId, minCorner, maxCorner);
+	m_bvh.remove(boxId);
+	bvhBoxModified(boxId);
+
+	// move last box into the gap
+	if (boxId != lastBoxId) {
+		m_boxes.boundingBox(lastBoxId, minCorner, maxCorner);
+		m_grid.remove(lastBoxId, minCorner, maxCorner);
+		m_grid.insert(boxId, minCorner, maxCorner);
+		m_bvh.renameBox(lastBoxId, boxId);
+		bvhBoxModified(lastBoxId);
+		m_boxBounds.set(boxId, minCorner, maxCorner);
+		m_boxes.copy(boxId, lastBoxId);
+		updateBoxBuffers(boxId);
+	}
+	m_boxes.pop_back();
+	m_boxBounds.resize(m_boxes.size());
+	m_chunkBoundsDirty = true;
+	checkBVHQuality();
+
+	// the element buffer keeps its size, but only the remaining elements are drawn
+	m_vertexBufferData.resize(m_boxes.size()*BoxMesh::VertexCount);
+	m_elementBufferData.resize(m_boxes.size()*BoxMesh::IndexCount);
+	m_instanceBufferData.resize(m_boxes.size());
+}
+
+
+void BoxObject::updateBoxBuffers(unsigned int boxId) {
+	releaseSceneCache();
+	VertexPNC * vertexBuffer = m_vertexBufferData.data() + boxId*BoxMesh::VertexCount;
+	unsigned int vertexCount = boxId*BoxMesh::VertexCount;
+	GLuint * elementBuffer = m_elementBufferData.data() + boxId*BoxMesh::IndexCount;
+	m_boxes.copy2Buffer(boxId, vertexBuffer, elementBuffer, vertexCount);
+	m_boxes.copy2InstanceBuffer(boxId, m_instanceBufferData[boxId]);
+	// the element indexes of a box only depend on the box index, so the element buffer need not be updated
+	writeBoxBuffer(boxId, boxId);
+}
+
+
+void BoxObject::writeBoxBuffer(unsigned int firstBox, unsigned int lastBox) {
+	unsigned int boxCount = lastBox - firstBox + 1;
+	if (m_renderMode == RM_Instanced) {
+		if (!m_instanceVbo.isCreated())
+			return;
+		m_instanceVbo.bind();
+		m_instanceVbo.write(firstBox*sizeof(BoxInstance), m_instanceBufferData.data() + firstBox, boxCount*sizeof(BoxInstance));
+		m_instanceVbo.release();
+		return;
+	}
+	if (!m_vbo.isCreated())
+		return;
+
+	// only update the modified portion of the data; alternatively, m_vbo.allocate() would (re-) copy the
+	// entire buffer, which can be slow
+	m_vbo.bind();
+	if (m_renderMode == RM_SharedCorners) {
+		std::vector<VertexPC> corners(boxCount*BoxMesh::CornerVertexCount);
+		VertexPC * vertexBuffer = corners.data();
+		for (unsigned int boxId=firstBox; boxId<=lastBox; ++boxId)
+			m_boxes.copy2CornerBuffer(boxId, vertexBuffer);
+		m_vbo.write(firstBox*BoxMesh::CornerVertexCount*sizeof(VertexPC), corners.data(), corners.size()*sizeof(VertexPC));
+	}
+	else {
+		unsigned int vertexOffset = firstBox*BoxMesh::VertexCount;
+		m_vbo.write(vertexOffset*sizeof(VertexPNC), m_vertexBufferData.data() + vertexOffset,
+					boxCount*BoxMesh::VertexCount*sizeof(VertexPNC));
+	}
+	m_vbo.release();
+}
+
+
+void BoxObject::reallocateBoxBuffers(unsigned int boxCapacity) {
+	if (m_renderMode == RM_Instanced) {
+		if (!m_instanceVbo.isCreated())
+			return;
+		m_instanceVbo.bind();
+		m_instanceVbo.allocate(boxCapacity*sizeof(BoxInstance));
+		m_instanceVbo.release();
+	}
+	else {
+		if (!m_vbo.isCreated())
+			return;
+		unsigned int boxMemSize = (m_renderMode == RM_SharedCorners) ? BoxMesh::CornerVertexCount*sizeof(VertexPC)
+																	 : BoxMesh::VertexCount*sizeof(VertexPNC);
+		m_vbo.bind();
+		m_vbo.allocate(boxCapacity*boxMemSize);
+		m_vbo.release();
+		setupElementBatches(boxCapacity);
+		m_gpuCullingDirty = true;
+		m_ebo.bind();
+		m_elementBatches.allocate(m_ebo);
+		m_ebo.release();
+	}
+	m_bufferBoxCapacity = boxCapacity;
+	qDebug() << "BoxObject - Buffers reallocated for" << boxCapacity << "boxes";
+	writeBoxBuffer(0, m_boxes.size() - 1);
+}
+
+
+void BoxObject::setupElementBatches(unsigned int boxCount) {
+	if (m_renderMode == RM_SharedCorners)
+		setupCornerElementBatches(boxCount);
+	else if (m_triangleStrips)
+		setupStripElementBatches(boxCount);
+	else {
+		// the element indexes of a box only depend on the box index, so for boxes beyond m_elementBufferData
+		// we use the indexes of the first box, shifted to the vertexes of the box
+		std::vector<GLuint> elements(m_elementBufferData);
+		elements.resize(boxCount*BoxMesh::IndexCount);
+		for (unsigned int i=m_elementBufferData.size(); i<elements.size(); ++i)
+			elements[i] = elements[i % BoxMesh::IndexCount] + (i/BoxMesh::IndexCount)*BoxMesh::VertexCount;
+		m_elementBatches.setup(elements, BoxMesh::VertexCount, BoxMesh::IndexCount);
+	}
+}
+
+
+void BoxObject::setupStripElementBatches(unsigned int boxCount) {
+	// the element indexes of a box only depend on the box index, so they need not be stored
+	std::vector<GLuint> stripElements(boxCount*BoxMesh::StripIndexCount);
+	GLuint * elementBuffer = stripElements.data();
+	unsigned int vertexCount = 0;
+	for (unsigned int i=0; i<boxCount; ++i)
+		BoxMesh::copyStripElements2Buffer(elementBuffer, vertexCount);
+	m_elementBatches.setup(stripElements, BoxMesh::VertexCount, BoxMesh::StripIndexCount, GL_TRIANGLE_STRIP);
+	qDebug() << "BoxObject - Triangle strips with" << stripElements.size() << "indexes instead of"
+			 << boxCount*BoxMesh::IndexCount << "for triangles";
+}
+
+
+void BoxObject::releaseSceneCache() {
+	if (!m_sceneCache.isOpen())
+		return;
+	const VertexPNC * vertexes = m_sceneCache.vertexes();
+	m_vertexBufferData.assign(vertexes, vertexes + m_sceneCache.boxCount()*BoxMesh::VertexCount);
+	m_sceneCache.close();
+}
+
+
+void BoxObject::cornerBufferData(std::vector<VertexPC> & corners) const {
+	corners.resize(m_boxes.size()*BoxMesh::CornerVertexCount);
+	VertexPC * vertexBuffer = corners.data();
+	for (unsigned int i=0; i<m_boxes.size(); ++i)
+		m_boxes.copy2CornerBuffer(i, vertexBuffer);
+}
+
+
+void BoxObject::setupCornerElementBatches(unsigned int boxCount) {
+	std::vector<GLuint> cornerElements(boxCount*BoxMesh::IndexCount);
+	GLuint * elementBuffer = cornerElements.data();
+	unsigned int vertexCount = 0;
+	for (unsigned int i=0; i<boxCount; ++i)
+		BoxMesh::copyCornerElements2Buffer(elementBuffer, vertexCount);
+	// here, vertexes are shared between faces, so the triangle order matters; the provoking vertexes are kept,
+	// since the triangles themselves are not modified
+	double acmr = averageCacheMissRatio(cornerElements.data(), cornerElements.size());
+	optimizeVertexCache(cornerElements, BoxMesh::IndexCount);
+	qDebug() << "BoxObject - Shared corners, vertex cache optimization: ACMR" << acmr << "->"
+			 << averageCacheMissRatio(cornerElements.data(), cornerElements.size());
+	m_elementBatches.setup(cornerElements, BoxMesh::CornerVertexCount, BoxMesh::IndexCount);
+}
+
+
+void BoxObject::updateBoxBounds() {
+	m_boxBounds.resize(m_boxes.size());
+	for (unsigned int i=0; i<m_boxes.size(); ++i) {
+		QVector3D minCorner, maxCorner;
+		m_boxes.boundingBox(i, minCorner, maxCorner);
+		m_boxBounds.set(i, minCorner, maxCorner);
+	}
+	m_chunkBoundsDirty = true;
+}
+
+
+void BoxObject::updateLevelsOfDetail() {
+	QElapsedTimer t;
+	t.start();
+	m_lod.build(m_boxes, m_grid);
+
+	const BoxStore & proxies = m_lod.m_proxies;
+	std::vector<VertexPNC> vertexes(proxies.size()*BoxMesh::VertexCount);
+	std::vector<GLuint> elements(proxies.size()*BoxMesh::IndexCount);
+	VertexPNC * vertexBuffer = vertexes.data();
+	GLuint * elementBuffer = elements.data();
+	unsigned int vertexCount = 0;
+	for (unsigned int i=0; i<proxies.size(); ++i)
+		proxies.copy2Buffer(i, vertexBuffer, elementBuffer, vertexCount);
+
+	// the vertex array object keeps the attribute setup and the element buffer, when buffers are re-allocated
+	bool setupAttributes = !m_lodVao.isCreated();
+	if (setupAttributes) {
+		m_lodVao.create();
+		m_lodVbo.create();
+		m_lodVbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+		m_lodEbo.create();
+		m_lodEbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+	}
+	m_lodVao.bind();
+	m_lodVbo.bind();
+	m_lodVbo.allocate(vertexes.data(), vertexes.size()*sizeof(VertexPNC));
+	m_lodEbo.bind();
+	m_lodBatches.setup(elements, BoxMesh::VertexCount, BoxMesh::IndexCount);
+	m_lodBatches.allocate(m_lodEbo);
+	if (setupAttributes) {
+		// same vertex layout as in RM_Vertexes mode
+		m_shaderProgram->enableAttributeArray(0);
+		m_shaderProgram->setAttributeBuffer(0, GL_FLOAT, 0, 3, sizeof(VertexPNC));
+		m_shaderProgram->enableAttributeArray(1);
+		m_shaderProgram->setAttributeBuffer(1, GL_INT_2_10_10_10_REV, offsetof(VertexPNC, n), 4, sizeof(VertexPNC));
+		m_shaderProgram->enableAttributeArray(2);
+		m_shaderProgram->setAttributeBuffer(2, GL_UNSIGNED_BYTE, offsetof(VertexPNC, r), 4, sizeof(VertexPNC));
+	}
+	m_lodVao.release();
+	m_lodVbo.release();
+	m_lodEbo.release();
+	m_lodGeneration = m_generation;
+
+	qDebug() << "BoxObject -" << m_lod.m_tiles.size() << "level of detail tiles with" << proxies.size()
+			 << "merged boxes built in" << t.elapsed() << "ms";
+}
+
+
+void BoxObject::cullChunks(const Frustum & frustum, const DepthPyramid * occluders) {
+	if (m_chunkBoundsDirty)
+		updateChunkBounds();
+	boxesInFrustum(m_chunkBounds, frustum, m_visibleChunks);
+	unsigned int frustumChunks = m_visibleChunks.size();
+
+	// occlusion test only for chunks within the frustum
+	if (occluders != nullptr) {
+		auto hidden = [this, occluders](unsigned int chunkId) {
+			QVector3D minCorner(m_chunkBounds.m_minX[chunkId], m_chunkBounds.m_minY[chunkId], m_chunkBounds.m_minZ[chunkId]);
+			QVector3D maxCorner(m_chunkBounds.m_maxX[chunkId], m_chunkBounds.m_maxY[chunkId], m_chunkBounds.m_maxZ[chunkId]);
+			return occluders->isOccluded(minCorner, maxCorner);
+		};
+		m_visibleChunks.erase(std::remove_if(m_visibleChunks.begin(), m_visibleChunks.end(), hidden), m_visibleChunks.end());
+	}
+
+	// chunk indexes are sorted, so neighboring visible chunks can be drawn as one range
+	m_drawRanges.clear();
+	for (unsigned int chunkId : m_visibleChunks) {
+		unsigned int first = chunkId*CullChunkSize;
+		unsigned int count = qMin(first + CullChunkSize, m_boxes.size()) - first;
+		if (!m_drawRanges.empty() && m_drawRanges.back().m_first + m_drawRanges.back().m_count == first)
+			m_drawRanges.back().m_count += count;
+		else
+			m_drawRanges.push_back(ElementBatches::Range{first, count});
+	}
+	m_drawnChunks = m_visibleChunks.size();
+	m_culledChunks = m_chunkBounds.size() - frustumChunks;
+	m_occludedChunks = frustumChunks - m_drawnChunks;
+}
+
+
+bool BoxObject::verifyGPUCulling() {
+	if (m_chunkBoundsDirty)
+		updateChunkBounds();
+	if (m_chunkBounds.size() == 0)
+		return true;
+	m_gpuCuller.setup(m_chunkBounds, CullChunkSize, m_boxes.size(), m_elementBatches);
+
+	// cameras around the scene looking at its center with different viewing angles and far planes within the
+	// scene, a camera within the scene looking sideways with a distant near plane and a camera looking down
+	// steeply, so that each of the frustum planes separates visible from culled chunks
+	const BoxBounds & cb = m_chunkBounds;
+	QVector3D minCorner(*std::min_element(cb.m_minX.begin(), cb.m_minX.end()), *std::min_element(cb.m_minY.begin(), cb.m_minY.end()),
+						*std::min_element(cb.m_minZ.begin(), cb.m_minZ.end()));
+	QVector3D maxCorner(*std::max_element(cb.m_maxX.begin(), cb.m_maxX.end()), *std::max_element(cb.m_maxY.begin(), cb.m_maxY.end()),
+						*std::max_element(cb.m_maxZ.begin(), cb.m_maxZ.end()));
+	QVector3D center = 0.5f*(minCorner + maxCorner);
+	float radius = std::max(0.5f*(maxCorner - minCorner).length(), 1.f);
+	std::vector<QMatrix4x4> views(6);
+	for (int i=0; i<4; ++i) {
+		float angle = 0.3f + i*1.5708f;
+		QVector3D eye = center + radius*QVector3D(std::cos(angle), 0.5f, std::sin(angle));
+		views[i].perspective(30 + 10*i, 1.5f, 0.1f, (1 + 0.25f*i)*radius);
+		views[i].lookAt(eye, center, QVector3D(0,1,0));
+	}
+	views[4].perspective(60, 1.5f, 0.25f*radius, 2*radius);
+	views[4].lookAt(center, center + QVector3D(1, 0, 0.3f), QVector3D(0,1,0));
+	views[5].perspective(20, 1.5f, 0.1f, 4*radius);
+	views[5].lookAt(center + QVector3D(0, 0.8f*radius, 0), center + 0.3f*radius*QVector3D(1, 0, 1), QVector3D(0,1,0));
+
+	unsigned int mismatches = 0;
+	unsigned int visibleCount = 0;
+	std::vector<unsigned int> gpuChunks;
+	for (const QMatrix4x4 & worldToView : views) {
+		Frustum frustum(worldToView);
+		m_gpuCuller.cull(frustum);
+		m_gpuCuller.visibleChunks(gpuChunks);
+		cullChunks(frustum, nullptr);
+		visibleCount += m_visibleChunks.size();
+
+		std::vector<unsigned int> differentChunks;
+		std::set_symmetric_difference(gpuChunks.begin(), gpuChunks.end(), m_visibleChunks.begin(), m_visibleChunks.end(),
+									  std::back_inserter(differentChunks));
+		for (unsigned int chunkId : differentChunks) {
+			// chunks touching a plane may be classified differently due to rounding in the plane distance
+			QVector3D cmin(cb.m_minX[chunkId], cb.m_minY[chunkId], cb.m_minZ[chunkId]);
+			QVector3D cmax(cb.m_maxX[chunkId], cb.m_maxY[chunkId], cb.m_maxZ[chunkId]);
+			bool touchesPlane = false;
+			for (const QVector4D & p : frustum.m_planes) {
+				QVector3D c(p.x() >= 0 ? cmax.x() : cmin.x(), p.y() >= 0 ? cmax.y() : cmin.y(), p.z() >= 0 ? cmax.z() : cmin.z());
+				float dist = c.x()*p.x() + c.y()*p.y() + c.z()*p.z() + p.w();
+				float scale = std::fabs(c.x()*p.x()) + std::fabs(c.y()*p.y()) + std::fabs(c.z()*p.z()) + std::fabs(p.w());
+				if (std::fabs(dist) <= 1e-5f*scale)
+					touchesPlane = true;
+			}
+			if (!touchesPlane)
+				++mismatches;
+		}
+	}
+	qDebug() << "BoxObject - GPU culling checked for" << views.size() << "view frusta:" << visibleCount << "visible chunks,"
+			 << mismatches << "mismatches";
+	m_gpuCullingDirty = true;
+	return mismatches == 0;
+}
+
+
+void BoxObject::updateChunkBounds() {
+	unsigned int chunkCount = (m_boxes.size() + CullChunkSize - 1)/CullChunkSize;
+	m_chunkBounds.resize(chunkCount);
+	for (unsigned int chunkId=0; chunkId<chunkCount; ++chunkId) {
+		unsigned int first = chunkId*CullChunkSize;
+		unsigned int last = qMin(first + CullChunkSize, m_boxes.size());
+		QVector3D minCorner(m_boxBounds.m_minX[first], m_boxBounds.m_minY[first], m_boxBounds.m_minZ[first]);
+		QVector3D maxCorner(m_boxBounds.m_maxX[first], m_boxBounds.m_maxY[first], m_boxBounds.m_maxZ[first]);
+		for (unsigned int i=first+1; i<last; ++i) {
+			minCorner.setX(qMin(minCorner.x(), m_boxBounds.m_minX[i]));
+			minCorner.setY(qMin(minCorner.y(), m_boxBounds.m_minY[i]));
+			minCorner.setZ(qMin(minCorner.z(), m_boxBounds.m_minZ[i]));
+			maxCorner.setX(qMax(maxCorner.x(), m_boxBounds.m_maxX[i]));
+			maxCorner.setY(qMax(maxCorner.y(), m_boxBounds.m_maxY[i]));
+			maxCorner.setZ(qMax(maxCorner.z(), m_boxBounds.m_maxZ[i]));
+		}
+		m_chunkBounds.set(chunkId, minCorner, maxCorner);
+	}
+	m_chunkBoundsDirty = false;
+	m_gpuCullingDirty = true;
+}
+
+
+void BoxObject::pickBruteForce(const QVector3D & p1, const QVector3D & d, PickObject & po) const {
 	// now process all box objects
 	for (unsigned int i=0; i<m_boxes.size(); ++i) {
-		const BoxMesh & bm = m_boxes[i];
 		for (unsigned int j=0; j<6; ++j) {
 			float dist;
 			// is intersection point closes to viewer than previous intersection points?
-			if (bm.intersects(j, p1, d, dist)) {
+			if (m_boxes.intersects(i, j, p1, d, dist)) {
 				qDebug() << QString("Plane %1 of box %2 intersects line at normalized distance = %3").arg(j).arg(i).arg(dist);
 				// keep objects that is closer to near plane
 				if (dist < po.m_dist) {
@@ -184,6 +1028,83 @@ void BoxObject::pick(const QVector3D & p1, const QVector3D & d, PickObject & po)
 }
 
 
+void BoxObject::pickBVH(const QVector3D & p1, const QVector3D & d, PickObject & po) const {
+	// the line is only valid for t in [0..1], and we only need to look for hits closer than the one already in po
+	float tMax = qMin(po.m_dist, 1.f);
+	m_bvh.traverse(p1, d, tMax, [this, &p1, &d, &po](unsigned int boxId, float & tMax) {
+		pickBox(boxId, p1, d, po);
+		tMax = qMin(tMax, po.m_dist);
+	});
+}
+
+
+void BoxObject::pickGrid(const QVector3D & p1, const QVector3D & d, PickObject & po) const {
+	float tMax = qMin(po.m_dist, 1.f);
+	m_grid.traverse(p1, d, tMax, [this, &p1, &d, &po](unsigned int boxId, float & tMax) {
+		pickBox(boxId, p1, d, po);
+		tMax = qMin(tMax, po.m_dist);
+	});
+}
+
+
+void BoxObject::pickSlabTest(const QVector3D & p1, const QVector3D & d, PickObject & po) const {
+	float tMax = qMin(po.m_dist, 1.f);
+	float tEnter;
+	int boxId = nearestSlabHit(m_boxBounds, p1, d, tMax, tEnter);
+	if (boxId == -1)
+		return;
+
+	// For axis-aligned boxes (all boxes generated here) the bounding box is the box itself, so the
+	// box entered first is also the box hit first. We only need to find out which face was hit.
+	PickObject boxPo(po.m_dist, std::numeric_limits<unsigned int>::max());
+	pickBox((unsigned int)boxId, p1, d, boxPo);
+	if (boxPo.m_objectId == (unsigned int)boxId) {
+		po = boxPo;
+		return;
+	}
+	// The line only touches an edge of the box (the face test rejects hits on the face boundaries),
+	// or the box is not axis-aligned. Use the exact test for all candidates instead.
+	pickBVH(p1, d, po);
+}
+
+
+void BoxObject::pickParallel(const QVector3D & p1, const QVector3D & d, PickObject & po) const {
+	const unsigned int chunkSize = qMax(1u, m_pickChunkSize);
+	const unsigned int chunkCount = (m_boxes.size() + chunkSize - 1)/chunkSize;
+	if (chunkCount == 0)
+		return;
+
+	// each chunk gets its own pick object, so no synchronization is needed while testing boxes
+	std::vector<PickObject> chunkResults(chunkCount, po);
+	auto pickChunk = [this, &p1, &d, &chunkResults, chunkSize](unsigned int chunk) {
+		unsigned int last = qMin<unsigned int>((chunk + 1)*chunkSize, m_boxes.size());
+		for (unsigned int i=chunk*chunkSize; i<last; ++i)
+			pickBox(i, p1, d, chunkResults[chunk]);
+	};
+
+	processChunksInParallel(chunkCount, pickChunk);
+
+	// reduce to closest hit; chunks are processed in box order and only closer hits replace the current one,
+	// so that the result is the same as with pickBruteForce()
+	for (const PickObject & chunkPo : chunkResults) {
+		if (chunkPo.m_dist < po.m_dist)
+			po = chunkPo;
+	}
+}
+
+
+void BoxObject::pickBox(unsigned int boxId, const QVector3D & p1, const QVector3D & d, PickObject & po) const {
+	for (unsigned int j=0; j<6; ++j) {
+		float dist;
+		if (m_boxes.intersects(boxId, j, p1, d, dist) && dist < po.m_dist) {
+			po.m_dist = dist;
+			po.m_objectId = boxId;
+			po.m_faceId = j;
+		}
+	}
+}
+
+
 void BoxObject::highlight(unsigned int boxId, unsigned int faceId) {
 	// we change the color of all vertexes of the selected box to lightgray
 	// and the vertex colors of the selected plane/face to light blue
@@ -195,23 +1116,47 @@ void BoxObject::highlight(unsigned int boxId, unsigned int faceId) {
 		else
 			faceCols[i] = QColor("#f3f3f3");
 	}
-	m_boxes[boxId].setFaceColors(faceCols);
+	m_boxes.setFaceColors(boxId, faceCols);
+	releaseSceneCache();
 
 	// advance the pointers and vertex numbers to the respected box position/numbering
-	VertexVNC * vertexBuffer = m_vertexBufferData.data() + boxId*6*4; // 6 planes, with 4 vertexes each
+	VertexPNC * vertexBuffer = m_vertexBufferData.data() + boxId*6*4; // 6 planes, with 4 vertexes each
 	unsigned int vertexCount = boxId*6*4;
 	GLuint * elementBuffer = m_elementBufferData.data() + boxId*6*6; // 6 planes, with 2 triangles with 3 indexes each
 	// then we update the respective portion of the vertexbuffer memory
-	m_boxes[boxId].copy2Buffer(vertexBuffer, elementBuffer, vertexCount);
+	m_boxes.copy2Buffer(boxId, vertexBuffer, elementBuffer, vertexCount);
+	m_boxes.copy2InstanceBuffer(boxId, m_instanceBufferData[boxId]);
 
 	QElapsedTimer t;
 	t.start();
-	// and now update the entire vertex buffer
-	m_vbo.bind();
-	// only update the modified portion of the data
-	m_vbo.write(boxId*6*4*sizeof(VertexVNC), m_vertexBufferData.data() + boxId*6*4, 6*4*sizeof(VertexVNC));
-	// alternatively use the call below, which (re-) copies the entire buffer, which can be slow
-	// m_vbo.allocate(m_vertexBufferData.data(), m_vertexBufferData.size()*sizeof(Vertex));
-	m_vbo.release();
-	qDebug() << t.elapsed();
+	// and now update the vertex buffer (or the instance data of the box in instanced mode)
+	writeBoxBuffer(boxId, boxId);
+	qDebug() << "BoxObject - highlighted box" << boxId << "face" << faceId << ", buffer update:" << t.elapsed() << "ms";
+}
+
+
+void BoxObject::highlight(const std::vector<unsigned int> & boxIds) {
+	if (boxIds.empty())
+		return;
+
+	releaseSceneCache();
+	unsigned int firstBox = m_boxes.size();
+	unsigned int lastBox = 0;
+	for (unsigned int boxId : boxIds) {
+		m_boxes.setColor(boxId, QColor("#f3f3f3"));
+		VertexPNC * vertexBuffer = m_vertexBufferData.data() + boxId*BoxMesh::VertexCount;
+		unsigned int vertexCount = boxId*BoxMesh::VertexCount;
+		GLuint * elementBuffer = m_elementBufferData.data() + boxId*BoxMesh::IndexCount;
+		m_boxes.copy2Buffer(boxId, vertexBuffer, elementBuffer, vertexCount);
+		m_boxes.copy2InstanceBuffer(boxId, m_instanceBufferData[boxId]);
+		firstBox = qMin(firstBox, boxId);
+		lastBox = qMax(lastBox, boxId);
+	}
+
+	QElapsedTimer t;
+	t.start();
+	// one write for the range of modified boxes is much faster than individual writes per box, even
+	// if some unmodified boxes in between are copied as well
+	writeBoxBuffer(firstBox, lastBox);
+	qDebug() << "BoxObject - highlighted" << boxIds.size() << "boxes, buffer update:" << t.elapsed() << "ms";
 }
@@ -15,26 +15,94 @@ License    : BSD License,
 #include <QOpenGLBuffer>
 #include <QOpenGLVertexArrayObject>
 
+#include <future>
+
 QT_BEGIN_NAMESPACE
 class QOpenGLShaderProgram;
+class QOpenGLTimeMonitor;
 QT_END_NAMESPACE
 
 #include "BoxMesh.h"
+#include "BoxStore.h"
+#include "BoxBVH.h"
+#include "BoxGrid.h"
+#include "BoxBounds.h"
+#include "BoxLOD.h"
+#include "ElementBatches.h"
+#include "GPUCulling.h"
+#include "SceneCache.h"
 
 struct PickObject;
+class Frustum;
+class DepthPyramid;
 
 /*! A container for all the boxes.
 	Basically creates the geometry of the individual boxes and populates the buffers.
 */
 class BoxObject {
 public:
+	/*! Different algorithms to find the box hit by a pick line. */
+	enum PickMethod {
+		/*! Test all faces of all boxes. */
+		PM_BruteForce,
+		/*! Traverse bounding volume hierarchy (m_bvh) front-to-back. */
+		PM_BVH,
+		/*! Walk through cells of the box lattice (m_grid) along the pick line. */
+		PM_Grid,
+		/*! Vectorized slab test against bounding boxes of all boxes (m_boxBounds), exact face test only for the closest box. */
+		PM_SlabTest,
+		/*! Test all faces of all boxes, with boxes split into chunks of m_pickChunkSize boxes that are processed in parallel. */
+		PM_Parallel,
+		NUM_PM
+	};
+
+	/*! Different ways to store and render the box geometry. */
+	enum RenderMode {
+		/*! Each box has its own 24 vertexes and 36 indexes in m_vbo/m_ebo. */
+		RM_Vertexes,
+		/*! All boxes share a unit cube mesh in m_vbo/m_ebo, which is drawn once per box with the
+			per-box translation, scale and face colors from m_instanceVbo (needs VertexNormalColorInstanced.vert).
+			Boxes are rendered as their bounding boxes, which is exact for axis-aligned boxes only.
+		*/
+		RM_Instanced,
+		/*! Each box has its 8 corners (shared by all faces) and 36 indexes in m_vbo/m_ebo (needs
+			VertexColorSharedCorners.vert and diffuseFlat.frag). Each triangle takes the face color from its
+			provoking vertex, and normals are computed in the fragment shader (see BoxMesh::copy2CornerBuffer()).
+			The corner data is generated from m_boxes whenever it is written into m_vbo.
+		*/
+		RM_SharedCorners,
+		NUM_RM
+	};
+
 	BoxObject();
 
-	/*! The function is called during OpenGL initialization, where the OpenGL context is current. */
+	/*! The function is called during OpenGL initialization, where the OpenGL context is current.
+		Only the buffers needed for the current m_renderMode are created. The shader program must match
+		the render mode. On OpenGL 4.3 contexts, GPU culling (m_gpuCuller) is set up as well (not in RM_Instanced mode).
+	*/
 	void create(QOpenGLShaderProgram * shaderProgramm);
 	void destroy();
 
-	void render();
+	/*! Draws all boxes. If batchTimers is given (vertex mode only), a GPU time stamp is recorded before
+		the first and after each draw batch (see ElementBatches::draw()).
+		If frustum is given and m_frustumCulling is enabled (not in RM_Instanced mode), only the chunks of
+		boxes intersecting the frustum are drawn, and no time stamps are recorded. Chunks are culled on the
+		GPU if m_gpuCulling is set and GPU culling is available (see GPUCulling), otherwise on the CPU (see cullChunks()).
+		If occluders is given as well, chunks hidden behind its depth buffer are skipped, too (always culled on the CPU).
+	*/
+	void render(QOpenGLTimeMonitor * batchTimers = nullptr, const Frustum * frustum = nullptr,
+				const DepthPyramid * occluders = nullptr);
+
+	/*! Draws the boxes with levels of detail (RM_Vertexes mode only, see BoxLOD): tiles close to viewPos with
+		all boxes, tiles further away with merged boxes per column or with heightfield blocks. If m_frustumCulling
+		is enabled, tiles outside the frustum are skipped, as well as tiles hidden behind occluders (if given).
+		The levels of detail are rebuilt first, if boxes were modified.
+		Proxies are drawn without hover highlighting: the uniform hoverBoxId (at hoverBoxIdLocation in the
+		bound shader program) is set to -1 before the proxy draws and left at -1, SceneView::paintGL() sets it
+		again each frame before drawing the boxes.
+	*/
+	void renderLevelsOfDetail(const QVector3D & viewPos, const Frustum & frustum, int hoverBoxIdLocation,
+							  const DepthPyramid * occluders = nullptr);
 
 	/*! Thread-save pick function.
 		Checks if any of the box object surfaces is hit by the ray defined by "p1 + d [0..1]" and
@@ -42,13 +110,104 @@ public:
 	*/
 	void pick(const QVector3D & p1, const QVector3D & d, PickObject & po) const;
 
+	/*! Rebuilds the bounding volume hierarchy from the current box geometry. */
+	void updateBVH();
+	/*! Checks if a bounding volume hierarchy rebuild in the background has finished, and if so,
+		replaces m_bvh with the new tree. Call this function regularly, e.g. once per frame.
+	*/
+	void pollBVHRebuild();
+	/*! Updates structure-of-arrays copy of the box bounding boxes from the current box geometry. */
+	void updateBoxBounds();
+
+	/*! Applies the transformation to box with index boxId and updates buffers and all picking structures.
+		Mind: OpenGL-context must be current when we call this function!
+	*/
+	void transformBox(unsigned int boxId, const QMatrix4x4 & transform);
+	/*! Appends a box, updates buffers and all picking structures and returns the index of the new box.
+		Mind: OpenGL-context must be current when we call this function!
+	*/
+	unsigned int addBox(const BoxMesh & box);
+	/*! Appends all boxes of the store, updates buffers and all picking structures and returns the index of
+		the first new box. The buffer data of the new boxes is generated in parallel. The buffers grow in steps
+		(doubling their capacity), so that appending many small sets of boxes does not copy all data each time.
+		Mind: OpenGL-context must be current when we call this function!
+	*/
+	unsigned int appendBoxes(const BoxStore & boxes);
+	/*! Removes the box with index boxId. The last box takes the place (and index) of the removed box.
+		Mind: OpenGL-context must be current when we call this function!
+	*/
+	void removeBox(unsigned int boxId);
+
 	/*! Changes color of box and face to show that the box was clicked on. */
 	void highlight(unsigned int boxId, unsigned int faceId);
+	/*! Changes color of all given boxes to show that they were selected.
+		The vertex buffer is updated with a single write call covering all modified boxes.
+	*/
+	void highlight(const std::vector<unsigned int> & boxIds);
+
+	/*! Incremented whenever the box geometry changes (transformBox(), addBox(), removeBox()),
+		used to invalidate cached pick results.
+	*/
+	unsigned int				m_generation;
 
-	std::vector<BoxMesh>		m_boxes;
+	/*! Number of consecutive boxes in a culling chunk. The generated boxes are sorted in Morton order, so that
+		consecutive boxes are close to each other and each chunk covers a compact tile of the box field.
+	*/
+	static const unsigned int CullChunkSize = 128;
 
-	std::vector<VertexVNC>		m_vertexBufferData;
+	/*! Geometry storage used for rendering, can only be changed while the buffers are destroyed. */
+	RenderMode					m_renderMode;
+	/*! If true, box faces are drawn as triangle strips separated by primitive restart indexes, instead of
+		triangle lists (RM_Vertexes and RM_Instanced only). Can only be changed while the buffers are destroyed.
+	*/
+	bool						m_triangleStrips;
+
+	/*! If true, chunks of boxes outside the view frustum are skipped in render() (toggled with key C). */
+	bool						m_frustumCulling;
+	/*! If true, frustum culling is done on the GPU, if available (toggled with key G). */
+	bool						m_gpuCulling;
+	/*! Statistics of the last render() call with frustum culling on the CPU: drawn chunks, chunks outside
+		the frustum and chunks hidden behind the occluders.
+	*/
+	unsigned int				m_drawnChunks;
+	unsigned int				m_culledChunks;
+	unsigned int				m_occludedChunks;
+
+	/*! If true, boxes are drawn with renderLevelsOfDetail() (toggled with key L). */
+	bool						m_levelOfDetail;
+	/*! Tiles of boxes with levels of detail. */
+	BoxLOD						m_lod;
+	/*! Statistics of the last renderLevelsOfDetail() call: tiles drawn per level, culled tiles
+		(outside the frustum or hidden) and number of triangles drawn.
+	*/
+	unsigned int				m_lodTiles[BoxLOD::NUM_L];
+	unsigned int				m_lodCulledTiles;
+	unsigned int				m_lodTriangles;
+
+	/*! Algorithm used in pick(). */
+	PickMethod					m_pickMethod;
+	/*! Number of boxes processed per thread pool task in PM_Parallel mode. */
+	unsigned int				m_pickChunkSize;
+
+	/*! All boxes. */
+	BoxStore					m_boxes;
+
+	/*! Bounding volume hierarchy over all boxes in m_boxes, used for picking. */
+	BoxBVH						m_bvh;
+	/*! If m_bvh.degradation() exceeds this value, the tree is rebuilt in the background. */
+	float						m_bvhRebuildThreshold;
+	/*! Lattice used to place the generated boxes, with box indexes stored per cell, used for picking. */
+	BoxGrid						m_grid;
+	/*! Bounding boxes of all boxes in m_boxes as structure of arrays, used for picking. */
+	BoxBounds					m_boxBounds;
+	/*! Bounding boxes of chunks of CullChunkSize consecutive boxes, used for frustum culling. */
+	BoxBounds					m_chunkBounds;
+
+	/*! Vertex data of all boxes (RM_Vertexes), empty while the vertex data is taken from m_sceneCache. */
+	std::vector<VertexPNC>		m_vertexBufferData;
 	std::vector<GLuint>			m_elementBufferData;
+	/*! Per-box data for instanced rendering (RM_Instanced). */
+	std::vector<BoxInstance>	m_instanceBufferData;
 
 	/*! Wraps an OpenGL VertexArrayObject, that references the vertex coordinates and color buffers. */
 	QOpenGLVertexArrayObject	m_vao;
@@ -57,6 +216,107 @@ public:
 	QOpenGLBuffer				m_vbo;
 	/*! Holds elements. */
 	QOpenGLBuffer				m_ebo;
+	/*! Index data in m_ebo, split into batches with 16-bit indexes where possible. */
+	ElementBatches				m_elementBatches;
+	/*! Holds per-box data in RM_Instanced mode. */
+	QOpenGLBuffer				m_instanceVbo;
+	/*! Frustum culling and indirect draws on the GPU, only created if supported by the OpenGL context. */
+	GPUCulling					m_gpuCuller;
+	/*! Number of boxes m_vbo/m_ebo or m_instanceVbo have room for (at least m_boxes.size()). */
+	unsigned int				m_bufferBoxCapacity;
+
+private:
+	/*! Appends a box for each translation, with the given dimensions (x, y, z) and face colors, and fills
+		the buffer data. Boxes are generated in parallel.
+	*/
+	void generateBoxes(const std::vector<QVector3D> & translations, const float boxDims[3], const std::vector<QColor> & faceColors);
+	/*! Tests all faces of all boxes. */
+	void pickBruteForce(const QVector3D & p1, const QVector3D & d, PickObject & po) const;
+	/*! Tests only boxes whose bounding volumes are hit by the pick line. */
+	void pickBVH(const QVector3D & p1, const QVector3D & d, PickObject & po) const;
+	/*! Tests only boxes in lattice cells crossed by the pick line. */
+	void pickGrid(const QVector3D & p1, const QVector3D & d, PickObject & po) const;
+	/*! Finds box with closest bounding box hit, then tests the faces of this box only. */
+	void pickSlabTest(const QVector3D & p1, const QVector3D & d, PickObject & po) const;
+	/*! Tests all faces of all boxes, chunks of boxes are processed in parallel by the global thread pool. */
+	void pickParallel(const QVector3D & p1, const QVector3D & d, PickObject & po) const;
+	/*! Copies vertexes, indexes and instance data of box with index boxId into the buffer data and, if the
+		buffers exist already, into the vertex or instance buffer.
+	*/
+	void updateBoxBuffers(unsigned int boxId);
+	/*! Writes the data of boxes firstBox...lastBox into m_vbo or m_instanceVbo (depending on m_renderMode),
+		if the buffers exist already. The buffer must be large enough.
+	*/
+	void writeBoxBuffer(unsigned int firstBox, unsigned int lastBox);
+	/*! Reallocates m_vbo/m_ebo or m_instanceVbo (if the buffers exist already) for boxCapacity boxes, and
+		writes the data of all boxes.
+	*/
+	void reallocateBoxBuffers(unsigned int boxCapacity);
+	/*! Sets up m_elementBatches for boxCount boxes, for the current render mode. */
+	void setupElementBatches(unsigned int boxCount);
+	/*! Sets up m_elementBatches with triangle strips for boxCount boxes (m_triangleStrips mode). */
+	void setupStripElementBatches(unsigned int boxCount);
+	/*! Copies the vertex data from m_sceneCache into m_vertexBufferData and closes the cache (if open).
+		Called before box data is modified.
+	*/
+	void releaseSceneCache();
+	/*! Generates the shared corners of all boxes (RM_SharedCorners). */
+	void cornerBufferData(std::vector<VertexPC> & corners) const;
+	/*! Sets up m_elementBatches with triangles over shared corners for boxCount boxes (RM_SharedCorners). */
+	void setupCornerElementBatches(unsigned int boxCount);
+	/*! Rebuilds m_lod from the current boxes and writes the proxies into m_lodVbo/m_lodEbo. */
+	void updateLevelsOfDetail();
+	/*! Determines the chunks intersecting the frustum and not hidden behind occluders (if given), and
+		merges consecutive visible chunks into m_drawRanges.
+	*/
+	void cullChunks(const Frustum & frustum, const DepthPyramid * occluders);
+	/*! Recomputes m_chunkBounds from m_boxBounds, if boxes were modified. */
+	void updateChunkBounds();
+	/*! Compares the chunks found visible by the compute shader of m_gpuCuller with cullChunks() for several
+		view frusta around and within the scene. Returns false if a chunk differs, except for chunks touching a
+		frustum plane (where the plane distance is zero within float rounding).
+	*/
+	bool verifyGPUCulling();
+	/*! Starts rebuild of the bounding volume hierarchy in the background, if tree is degraded. */
+	void checkBVHQuality();
+	/*! Remembers that box boxId was modified, while a background rebuild is running. */
+	void bvhBoxModified(unsigned int boxId);
+
+	/*! Tests all faces of box with index boxId and updates po, if a face closer than po.m_dist is hit. */
+	void pickBox(unsigned int boxId, const QVector3D & p1, const QVector3D & d, PickObject & po) const;
+
+	/*! If true, m_chunkBounds must be recomputed. */
+	bool						m_chunkBoundsDirty;
+	/*! If true, the draw commands in m_gpuCuller must be set up again (chunk bounds or element data changed). */
+	bool						m_gpuCullingDirty;
+	/*! Shader program passed to create(), needed to set up the attributes of m_lodVao. */
+	QOpenGLShaderProgram		*m_shaderProgram;
+	/*! Vertex array object, vertex and element buffers of the proxies in m_lod (created on first use). */
+	QOpenGLVertexArrayObject	m_lodVao;
+	QOpenGLBuffer				m_lodVbo;
+	QOpenGLBuffer				m_lodEbo;
+	ElementBatches				m_lodBatches;
+	/*! Box geometry generation of m_lod. */
+	unsigned int				m_lodGeneration;
+	/*! Indexes of the tiles visible in the last renderLevelsOfDetail() call. */
+	std::vector<unsigned int>	m_visibleTiles;
+	/*! Proxy ranges drawn in renderLevelsOfDetail(). */
+	std::vector<ElementBatches::Range>	m_lodDrawRanges;
+
+	/*! Indexes of the chunks visible in the last cullChunks() call. */
+	std::vector<unsigned int>	m_visibleChunks;
+	/*! Box ranges drawn with frustum culling. */
+	std::vector<ElementBatches::Range>	m_drawRanges;
+
+	/*! Result of background rebuild of the bounding volume hierarchy, valid while a rebuild is running. */
+	std::future<BoxBVH>			m_bvhRebuild;
+	/*! Boxes modified while the background rebuild is running, these are updated in the new tree afterwards. */
+	std::vector<unsigned int>	m_bvhModifiedBoxes;
+
+	/*! Generated scene loaded from the cache file, mapped into memory until the box data is modified
+		(see releaseSceneCache()).
+	*/
+	SceneCache					m_sceneCache;
 };
 
 #endif // BOXOBJECT_H
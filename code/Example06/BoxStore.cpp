@@ -0,0 +1,96 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "BoxStore.h"
+
+void BoxStore::resize(unsigned int n) {
+	unsigned int oldSize = size();
+	m_vertices.resize(n*8);
+	m_planeInfo.resize(n*6);
+	m_colors.resize(n*6);
+	// initialize new boxes
+	if (n > oldSize) {
+		BoxMesh unitCube;
+		for (unsigned int i=oldSize; i<n; ++i)
+			set(i, unitCube);
+	}
+}
+
+
+void BoxStore::reserve(unsigned int n) {
+	m_vertices.reserve(n*8);
+	m_planeInfo.reserve(n*6);
+	m_colors.reserve(n*6);
+}
+
+
+void BoxStore::push_back(const BoxMesh & box) {
+	unsigned int boxId = size();
+	m_vertices.resize(m_vertices.size() + 8);
+	m_planeInfo.resize(m_planeInfo.size() + 6);
+	m_colors.resize(m_colors.size() + 6);
+	set(boxId, box);
+}
+
+
+void BoxStore::push_back(const QVector3D * vertices, const QRgb * faceColors) {
+	m_vertices.insert(m_vertices.end(), vertices, vertices + 8);
+	BoxMesh::Rect planeInfo[6];
+	BoxMesh::updatePlaneInfo(vertices, planeInfo);
+	m_planeInfo.insert(m_planeInfo.end(), planeInfo, planeInfo + 6);
+	m_colors.insert(m_colors.end(), faceColors, faceColors + 6);
+}
+
+
+void BoxStore::append(const BoxStore & boxes) {
+	m_vertices.insert(m_vertices.end(), boxes.m_vertices.begin(), boxes.m_vertices.end());
+	m_planeInfo.insert(m_planeInfo.end(), boxes.m_planeInfo.begin(), boxes.m_planeInfo.end());
+	m_colors.insert(m_colors.end(), boxes.m_colors.begin(), boxes.m_colors.end());
+}
+
+
+void BoxStore::set(unsigned int boxId, const BoxMesh & box) {
+	std::copy(box.vertices().begin(), box.vertices().end(), m_vertices.begin() + boxId*8);
+	std::copy(box.planeInfo().begin(), box.planeInfo().end(), m_planeInfo.begin() + boxId*6);
+	box.faceColors(m_colors.data() + boxId*6);
+}
+
+
+void BoxStore::copy(unsigned int targetBoxId, unsigned int sourceBoxId) {
+	std::copy(m_vertices.begin() + sourceBoxId*8, m_vertices.begin() + (sourceBoxId + 1)*8, m_vertices.begin() + targetBoxId*8);
+	std::copy(m_planeInfo.begin() + sourceBoxId*6, m_planeInfo.begin() + (sourceBoxId + 1)*6, m_planeInfo.begin() + targetBoxId*6);
+	std::copy(m_colors.begin() + sourceBoxId*6, m_colors.begin() + (sourceBoxId + 1)*6, m_colors.begin() + targetBoxId*6);
+}
+
+
+void BoxStore::transform(unsigned int boxId, const QMatrix4x4 & transform) {
+	QVector3D * vertices = m_vertices.data() + boxId*8;
+	for (unsigned int i=0; i<8; ++i)
+		vertices[i] = transform*vertices[i];
+	BoxMesh::updatePlaneInfo(vertices, m_planeInfo.data() + boxId*6);
+}
+
+
+void BoxStore::setColor(unsigned int boxId, const QColor & c) {
+	std::fill(m_colors.begin() + boxId*6, m_colors.begin() + (boxId + 1)*6, c.rgba());
+}
+
+
+void BoxStore::setFaceColors(unsigned int boxId, const std::vector<QColor> & c) {
+	Q_ASSERT(c.size() == 6);
+	for (unsigned int i=0; i<6; ++i)
+		m_colors[boxId*6 + i] = c[i].rgba();
+}
+
+
+size_t BoxStore::memSize() const {
+	return m_vertices.capacity()*sizeof(QVector3D) + m_planeInfo.capacity()*sizeof(BoxMesh::Rect) + m_colors.capacity()*sizeof(QRgb);
+}
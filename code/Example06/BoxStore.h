@@ -0,0 +1,95 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef BOXSTORE_H
+#define BOXSTORE_H
+
+#include <QColor>
+#include <QMatrix4x4>
+#include <vector>
+
+#include "BoxMesh.h"
+
+/*! A container for many boxes, that stores the data of all boxes in a few contiguous arrays
+	(structure of arrays) instead of individual BoxMesh objects with three heap allocations each.
+
+	Boxes are addressed by index. Per box, the store holds 8 vertexes (corners), 6 faces (with the
+	precomputed data for the line-face intersection test) and 6 face colors. Picking only touches
+	the face array, so that the faces of consecutive boxes are consecutive in memory.
+
+	BoxMesh is used to define individual boxes, which are then copied into the store with
+	push_back() or set(). The functions operating on box data are shared with BoxMesh.
+*/
+class BoxStore {
+public:
+	/*! Number of boxes. */
+	unsigned int size() const { return m_colors.size()/6; }
+	/*! Resizes the store to hold n boxes, new boxes are unit cubes. */
+	void resize(unsigned int n);
+	/*! Reserves memory for n boxes. */
+	void reserve(unsigned int n);
+	/*! Removes all boxes. */
+	void clear() { resize(0); }
+
+	/*! Appends a box. */
+	void push_back(const BoxMesh & box);
+	/*! Appends a box given by 8 vertexes (see BoxMesh::boxVertices()) and 6 face colors, without creating a BoxMesh. */
+	void push_back(const QVector3D * vertices, const QRgb * faceColors);
+	/*! Appends all boxes of another store. */
+	void append(const BoxStore & boxes);
+	/*! Removes the last box. */
+	void pop_back() { resize(size() - 1); }
+	/*! Replaces box with index boxId. Boxes with different indexes can be set from different threads. */
+	void set(unsigned int boxId, const BoxMesh & box);
+	/*! Copies box with index sourceBoxId to index targetBoxId. */
+	void copy(unsigned int targetBoxId, unsigned int sourceBoxId);
+
+	/*! Transforms the box (in-place operation, see BoxMesh::transform()). */
+	void transform(unsigned int boxId, const QMatrix4x4 & transform);
+	/*! Sets color of all faces of the box. */
+	void setColor(unsigned int boxId, const QColor & c);
+	/*! Sets 6 colors for the different sides of the box, see BoxMesh::setFaceColors(). */
+	void setFaceColors(unsigned int boxId, const std::vector<QColor> & c);
+
+	/*! Same as BoxMesh::intersects() for box with index boxId. */
+	bool intersects(unsigned int boxId, unsigned int planeIdx, const QVector3D & p1, const QVector3D & d, float & dist) const {
+		return BoxMesh::intersects(m_planeInfo[boxId*6 + planeIdx], p1, d, dist);
+	}
+	/*! Same as BoxMesh::boundingBox() for box with index boxId. */
+	void boundingBox(unsigned int boxId, QVector3D & minCorner, QVector3D & maxCorner) const {
+		BoxMesh::boundingBox(m_vertices.data() + boxId*8, minCorner, maxCorner);
+	}
+	/*! Same as BoxMesh::copy2Buffer() for box with index boxId. */
+	void copy2Buffer(unsigned int boxId, VertexPNC * & vertexBuffer, GLuint * & elementBuffer, unsigned int & elementStartIndex) const {
+		BoxMesh::copy2Buffer(m_vertices.data() + boxId*8, m_colors.data() + boxId*6, vertexBuffer, elementBuffer, elementStartIndex);
+	}
+	/*! Same as BoxMesh::copy2InstanceBuffer() for box with index boxId. */
+	void copy2InstanceBuffer(unsigned int boxId, BoxInstance & instance) const {
+		BoxMesh::copy2InstanceBuffer(m_vertices.data() + boxId*8, m_colors.data() + boxId*6, instance);
+	}
+
+	/*! Same as BoxMesh::copy2CornerBuffer() for box with index boxId. */
+	void copy2CornerBuffer(unsigned int boxId, VertexPC * & vertexBuffer) const {
+		BoxMesh::copy2CornerBuffer(m_vertices.data() + boxId*8, m_colors.data() + boxId*6, vertexBuffer);
+	}
+
+	/*! Memory used by the store in bytes. */
+	size_t memSize() const;
+
+	/*! 8 vertexes per box. */
+	std::vector<QVector3D>		m_vertices;
+	/*! 6 faces per box. */
+	std::vector<BoxMesh::Rect>	m_planeInfo;
+	/*! 6 face colors per box. */
+	std::vector<QRgb>			m_colors;
+};
+
+#endif // BOXSTORE_H
@@ -0,0 +1,251 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "DepthPyramid.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QVector4D>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/*! Tolerance for the quantization of the depth buffer (24 bits, steps of about 6e-8), so that
+	objects are not hidden behind their own faces.
+*/
+static const float DEPTH_TOLERANCE = 1e-6f;
+
+void DepthPyramid::create() {
+	m_f = QOpenGLContext::currentContext()->extraFunctions();
+
+	m_f->glGenFramebuffers(1, &m_fbo);
+	m_f->glGenRenderbuffers(1, &m_depthBuffer);
+	m_f->glGenBuffers(1, &m_pbo);
+
+	m_needsAllocation = true;
+	m_captureFailed = false;
+}
+
+
+void DepthPyramid::destroy() {
+	if (m_f == nullptr)
+		return;
+	if (m_fence != nullptr)
+		m_f->glDeleteSync(m_fence);
+	m_fence = nullptr;
+	m_f->glDeleteBuffers(1, &m_pbo);
+	m_f->glDeleteRenderbuffers(1, &m_depthBuffer);
+	m_f->glDeleteFramebuffers(1, &m_fbo);
+	m_f = nullptr;
+	m_levels.clear();
+}
+
+
+void DepthPyramid::resize(int width, int height) {
+	if (width == m_width && height == m_height)
+		return;
+	m_width = width;
+	m_height = height;
+	m_needsAllocation = true;
+}
+
+
+void DepthPyramid::capture(const QMatrix4x4 & worldToView) {
+	if (m_f == nullptr || m_captureFailed || m_width <= 0 || m_height <= 0)
+		return;
+
+	// discard a result not yet fetched
+	if (m_fence != nullptr) {
+		m_f->glDeleteSync(m_fence);
+		m_fence = nullptr;
+	}
+	if (m_needsAllocation)
+		allocate();
+
+	// discard errors of earlier calls, so that we can check the blit below
+	while (m_f->glGetError() != GL_NO_ERROR)
+		;
+
+	// copy (and resolve) the depth buffer, the formats of both depth buffers must match
+	GLuint defaultFbo = QOpenGLContext::currentContext()->defaultFramebufferObject();
+	m_f->glBindFramebuffer(GL_READ_FRAMEBUFFER, defaultFbo);
+	m_f->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
+	m_f->glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	if (m_f->glGetError() != GL_NO_ERROR) {
+		qWarning() << "Copying the depth buffer failed, occlusion culling is not available.";
+		m_captureFailed = true;
+		m_levels.clear();
+		m_f->glBindFramebuffer(GL_FRAMEBUFFER, defaultFbo);
+		return;
+	}
+
+	// with a bound pixel pack buffer, glReadPixels() returns immediately and the data is copied on the GPU
+	m_f->glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+	m_f->glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pbo);
+	m_f->glReadPixels(0, 0, m_width, m_height, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+	m_f->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	m_f->glBindFramebuffer(GL_FRAMEBUFFER, defaultFbo);
+	m_fence = m_f->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	m_captureWidth = m_width;
+	m_captureHeight = m_height;
+	m_captureWorldToView = worldToView;
+}
+
+
+bool DepthPyramid::fetch() {
+	if (m_fence == nullptr)
+		return false;
+	// poll only, do not wait for the GPU
+	GLenum res = m_f->glClientWaitSync(m_fence, 0, 0);
+	if (res != GL_ALREADY_SIGNALED && res != GL_CONDITION_SATISFIED)
+		return false;
+	m_f->glDeleteSync(m_fence);
+	m_fence = nullptr;
+
+	int w = m_captureWidth;
+	int h = m_captureHeight;
+	m_f->glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pbo);
+	const float * depth = reinterpret_cast<const float *>(
+		m_f->glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, w*h*sizeof(float), GL_MAP_READ_BIT));
+	bool success = (depth != nullptr);
+	if (success) {
+		// the number of levels only changes with the window size, so the vectors are usually reused
+		unsigned int levelCount = 1;
+		for (int s = std::max(w, h); s > 1; s = (s + 1)/2)
+			++levelCount;
+		m_levels.resize(levelCount);
+		m_levels[0].m_width = w;
+		m_levels[0].m_height = h;
+		m_levels[0].m_depth.assign(depth, depth + w*h);
+		m_f->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+		// each texel holds the farthest depth of the 2x2 texels below, odd sizes are handled by clamping
+		for (unsigned int l=1; l<levelCount; ++l) {
+			const Level & src = m_levels[l-1];
+			Level & dst = m_levels[l];
+			dst.m_width = (src.m_width + 1)/2;
+			dst.m_height = (src.m_height + 1)/2;
+			dst.m_depth.resize(dst.m_width*dst.m_height);
+			for (int j=0; j<dst.m_height; ++j) {
+				const float * row0 = src.m_depth.data() + 2*j*src.m_width;
+				const float * row1 = src.m_depth.data() + std::min(2*j + 1, src.m_height - 1)*src.m_width;
+				float * d = dst.m_depth.data() + j*dst.m_width;
+				for (int i=0; i<dst.m_width; ++i) {
+					int i0 = 2*i;
+					int i1 = std::min(2*i + 1, src.m_width - 1);
+					d[i] = std::max(std::max(row0[i0], row0[i1]), std::max(row1[i0], row1[i1]));
+				}
+			}
+		}
+		m_worldToView = m_captureWorldToView;
+	}
+	m_f->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	return success;
+}
+
+
+bool DepthPyramid::isOccluded(const QVector3D & minCorner, const QVector3D & maxCorner) const {
+	if (m_levels.empty())
+		return false;
+
+	// bounding rectangle (normalized device coordinates) and nearest depth of the projected box corners
+	float xmin = std::numeric_limits<float>::max();
+	float ymin = xmin;
+	float zmin = xmin;
+	float xmax = -xmin;
+	float ymax = -xmin;
+	for (int i=0; i<8; ++i) {
+		QVector4D p = m_worldToView * QVector4D(i & 1 ? maxCorner.x() : minCorner.x(),
+												i & 2 ? maxCorner.y() : minCorner.y(),
+												i & 4 ? maxCorner.z() : minCorner.z(), 1.f);
+		// corner in front of the near plane or behind the camera - projected rectangle is not bounded
+		if (p.w() <= 0 || p.z() < -p.w())
+			return false;
+		float invW = 1.f/p.w();
+		xmin = std::min(xmin, p.x()*invW);
+		xmax = std::max(xmax, p.x()*invW);
+		ymin = std::min(ymin, p.y()*invW);
+		ymax = std::max(ymax, p.y()*invW);
+		zmin = std::min(zmin, p.z()*invW);
+	}
+
+	// pixel rectangle, clipped to the viewport (parts outside are handled by the frustum test)
+	const Level & base = m_levels[0];
+	int x0 = (int)std::floor((std::max(xmin, -1.f)*0.5f + 0.5f)*base.m_width);
+	int x1 = (int)std::floor((std::min(xmax, 1.f)*0.5f + 0.5f)*base.m_width);
+	int y0 = (int)std::floor((std::max(ymin, -1.f)*0.5f + 0.5f)*base.m_height);
+	int y1 = (int)std::floor((std::min(ymax, 1.f)*0.5f + 0.5f)*base.m_height);
+	x0 = std::max(x0, 0);
+	y0 = std::max(y0, 0);
+	x1 = std::min(x1, base.m_width - 1);
+	y1 = std::min(y1, base.m_height - 1);
+	if (x0 > x1 || y0 > y1)
+		return false;
+
+	// go up the pyramid until the rectangle covers at most 2x2 texels
+	unsigned int level = 0;
+	while ((x1 - x0 > 1 || y1 - y0 > 1) && level + 1 < m_levels.size()) {
+		x0 >>= 1;
+		x1 >>= 1;
+		y0 >>= 1;
+		y1 >>= 1;
+		++level;
+	}
+
+	const Level & l = m_levels[level];
+	float maxDepth = 0;
+	for (int j=y0; j<=y1; ++j)
+		for (int i=x0; i<=x1; ++i)
+			maxDepth = std::max(maxDepth, l.m_depth[j*l.m_width + i]);
+
+	// window depth with default depth range 0..1
+	return zmin*0.5f + 0.5f > maxDepth + DEPTH_TOLERANCE;
+}
+
+
+void DepthPyramid::allocate() {
+	qDebug() << "Creating depth pyramid framebuffer with size " << m_width << "x" << m_height;
+
+	// blitting depth requires the same format as the depth buffer of the default framebuffer
+	QSurfaceFormat format = QOpenGLContext::currentContext()->format();
+	GLenum depthFormat = GL_DEPTH_COMPONENT24;
+	GLenum attachment = GL_DEPTH_ATTACHMENT;
+	if (format.stencilBufferSize() > 0) {
+		depthFormat = GL_DEPTH24_STENCIL8;
+		attachment = GL_DEPTH_STENCIL_ATTACHMENT;
+	}
+	else if (format.depthBufferSize() == 16)
+		depthFormat = GL_DEPTH_COMPONENT16;
+
+	m_f->glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+	m_f->glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	m_f->glRenderbufferStorage(GL_RENDERBUFFER, depthFormat, m_width, m_height);
+	m_f->glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	m_f->glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, m_depthBuffer);
+
+	// depth only framebuffer
+	const GLenum noBuffer = GL_NONE;
+	m_f->glDrawBuffers(1, &noBuffer);
+	m_f->glReadBuffer(GL_NONE);
+	if (m_f->glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		qWarning() << "Depth pyramid framebuffer is incomplete.";
+	m_f->glBindFramebuffer(GL_FRAMEBUFFER, QOpenGLContext::currentContext()->defaultFramebufferObject());
+
+	// pixel buffer object with one float per pixel
+	m_f->glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pbo);
+	m_f->glBufferData(GL_PIXEL_PACK_BUFFER, m_width*m_height*sizeof(float), nullptr, GL_STREAM_READ);
+	m_f->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_needsAllocation = false;
+}
@@ -0,0 +1,118 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef DEPTHPYRAMID_H
+#define DEPTHPYRAMID_H
+
+#include <QtGui/QOpenGLFunctions>
+#include <QMatrix4x4>
+
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+class QOpenGLExtraFunctions;
+QT_END_NAMESPACE
+
+/*! A hierarchical depth buffer (depth pyramid), used for occlusion culling.
+
+	capture() copies the depth buffer of the default framebuffer into an offscreen framebuffer
+	(this also resolves multisampled depth buffers) and reads it back asynchronously into a pixel buffer
+	object, just like the pick pixel in PickFramebuffer. Once the GPU is done, fetch() builds the pyramid
+	on the CPU: level 0 holds the window depth (0..1) of each pixel, each further level holds the maximum
+	(i.e. farthest) depth of 2x2 texels of the level below.
+
+	isOccluded() projects a bounding box with the world to view matrix of the captured frame and compares
+	its nearest depth with the farthest depth in its screen rectangle, taken from the pyramid level where the
+	rectangle covers at most 2x2 texels. If the box is behind all of these pixels, it is hidden.
+
+	Mind: the pyramid always lags at least one frame behind. Objects hidden in the captured frame may
+	have become visible meanwhile (camera or objects moved). Such objects are missing for a frame,
+	hence another frame should be rendered as long as the pyramid does not match the current view.
+
+	Like all other objects, the OpenGL resources must be released by calling destroy()
+	(with the OpenGL context being current).
+*/
+class DepthPyramid {
+public:
+	/*! Creates framebuffer and pixel buffer object, OpenGL context must be current. */
+	void create();
+	/*! Destroys OpenGL resources and the pyramid, OpenGL context must be current. */
+	void destroy();
+
+	/*! Sets new framebuffer size (in pixels), must match the size of the default framebuffer. The buffers
+		are re-allocated in the next call to capture(), so that this function can be called from resizeGL().
+	*/
+	void resize(int width, int height);
+
+	/*! Starts the read back of the depth buffer of the default framebuffer (must be bound),
+		rendered with the given world to view matrix.
+	*/
+	void capture(const QMatrix4x4 & worldToView);
+
+	/*! Returns true, if a depth buffer read back is in progress. */
+	bool pending() const { return m_fence != nullptr; }
+
+	/*! If the depth buffer requested with capture() is available, builds the pyramid and returns true.
+		Returns false if the GPU is not yet done (try again next frame).
+	*/
+	bool fetch();
+
+	/*! Returns true, if a pyramid has been built. */
+	bool isValid() const { return !m_levels.empty(); }
+
+	/*! World to view matrix of the frame the pyramid was built from. */
+	const QMatrix4x4 & worldToView() const { return m_worldToView; }
+
+	/*! Returns true, if the bounding box is completely hidden behind the depth buffer of the captured frame.
+		Boxes that are not completely in front of the camera are never reported as hidden.
+	*/
+	bool isOccluded(const QVector3D & minCorner, const QVector3D & maxCorner) const;
+
+private:
+	/*! A level of the pyramid, with width*height depth values (row 0 is the bottom row). */
+	struct Level {
+		int					m_width;
+		int					m_height;
+		std::vector<float>	m_depth;
+	};
+
+	/*! Allocates the depth buffer (same format as the default framebuffer's depth buffer, needed for
+		blitting) and the pixel buffer object with the current size.
+	*/
+	void allocate();
+
+	QOpenGLExtraFunctions	*m_f = nullptr;
+
+	GLuint					m_fbo = 0;
+	GLuint					m_depthBuffer = 0;
+	/*! Pixel buffer object that receives the depth buffer (one float per pixel). */
+	GLuint					m_pbo = 0;
+	/*! Fence inserted after the read back, nullptr if no read is in progress. */
+	GLsync					m_fence = nullptr;
+
+	int						m_width = 0;
+	int						m_height = 0;
+	/*! If true, buffers need to be (re-)allocated in next call to capture(). */
+	bool					m_needsAllocation = true;
+	/*! Set if copying the depth buffer failed, capture() does nothing afterwards. */
+	bool					m_captureFailed = false;
+
+	/*! Size and world to view matrix of the depth buffer being read back. */
+	int						m_captureWidth = 0;
+	int						m_captureHeight = 0;
+	QMatrix4x4				m_captureWorldToView;
+
+	/*! Pyramid levels, level 0 has the size of the captured depth buffer. */
+	std::vector<Level>		m_levels;
+	QMatrix4x4				m_worldToView;
+};
+
+#endif // DEPTHPYRAMID_H
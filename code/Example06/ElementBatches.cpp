@@ -0,0 +1,140 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "ElementBatches.h"
+
+#include <QOpenGLBuffer>
+#include <QOpenGLContext>
+#include <QOpenGLTimeMonitor>
+#include <QDebug>
+
+void ElementBatches::setup(const std::vector<GLuint> & elements, unsigned int verticesPerObject, unsigned int indexesPerObject,
+						   GLenum primitiveType)
+{
+	Q_ASSERT(elements.size() % indexesPerObject == 0);
+	m_primitiveType = primitiveType;
+	m_verticesPerObject = verticesPerObject;
+	m_indexesPerObject = indexesPerObject;
+	unsigned int objectCount = elements.size()/indexesPerObject;
+	m_objectsPerBatch = MaxBatchVertexCount/verticesPerObject;
+
+	// 16-bit indexes, if all vertexes fit into one batch or if we can draw with base vertex
+	m_drawElementsBaseVertex = nullptr;
+	m_use16Bit = objectCount <= m_objectsPerBatch;
+	if (!m_use16Bit) {
+		QOpenGLContext * ctx = QOpenGLContext::currentContext();
+		m_drawElementsBaseVertex = reinterpret_cast<DrawElementsBaseVertexFunc>(ctx->getProcAddress("glDrawElementsBaseVertex"));
+		m_use16Bit = (m_drawElementsBaseVertex != nullptr);
+	}
+
+	if (!m_use16Bit) {
+		m_elements32 = elements;
+		m_elements16 = std::vector<GLushort>();
+		m_objectsPerBatch = objectCount;
+		return;
+	}
+
+	m_elements32 = std::vector<GLuint>();
+	m_elements16.resize(elements.size());
+	for (unsigned int i=0; i<elements.size(); ++i) {
+		if (elements[i] == RestartIndex) {
+			m_elements16[i] = 0xFFFF;
+			continue;
+		}
+		unsigned int objectId = i/indexesPerObject;
+		unsigned int batchVertexOffset = (objectId/m_objectsPerBatch)*m_objectsPerBatch*verticesPerObject;
+		Q_ASSERT(elements[i] >= objectId*verticesPerObject && elements[i] < (objectId + 1)*verticesPerObject);
+		m_elements16[i] = GLushort(elements[i] - batchVertexOffset);
+	}
+	qDebug() << "ElementBatches -" << batchCount(objectCount) << "batches with 16-bit indexes, saved"
+			 << (elements.size()*sizeof(GLuint) - memSize())/1024.0 << "kByte";
+}
+
+
+void ElementBatches::allocate(QOpenGLBuffer & ebo) const {
+	if (m_use16Bit)
+		ebo.allocate(m_elements16.data(), memSize());
+	else
+		ebo.allocate(m_elements32.data(), memSize());
+}
+
+
+void ElementBatches::draw(unsigned int objectCount, QOpenGLTimeMonitor * timeMonitor) const {
+	int samplesLeft = timeMonitor != nullptr ? timeMonitor->sampleCount() : 0;
+	if (samplesLeft > 0) {
+		timeMonitor->recordSample();
+		--samplesLeft;
+	}
+
+	if (m_primitiveType != GL_TRIANGLES)
+		glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+
+	if (!m_use16Bit) {
+		glDrawElements(m_primitiveType, objectCount*m_indexesPerObject, GL_UNSIGNED_INT, nullptr);
+		if (samplesLeft > 0)
+			timeMonitor->recordSample();
+	}
+	else {
+		for (unsigned int first=0; first<objectCount; first += m_objectsPerBatch) {
+			unsigned int count = qMin(m_objectsPerBatch, objectCount - first);
+			const void * offset = reinterpret_cast<const void *>(first*m_indexesPerObject*sizeof(GLushort));
+			// first batch does not need a base vertex
+			if (first == 0)
+				glDrawElements(m_primitiveType, count*m_indexesPerObject, GL_UNSIGNED_SHORT, offset);
+			else
+				m_drawElementsBaseVertex(m_primitiveType, count*m_indexesPerObject, GL_UNSIGNED_SHORT, offset,
+										 first*m_verticesPerObject);
+			if (samplesLeft > 0) {
+				timeMonitor->recordSample();
+				--samplesLeft;
+			}
+		}
+	}
+
+	if (m_primitiveType != GL_TRIANGLES)
+		glDisable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+}
+
+
+void ElementBatches::drawRanges(const std::vector<Range> & ranges) const {
+	if (m_primitiveType != GL_TRIANGLES)
+		glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+
+	for (const Range & r : ranges) {
+		if (!m_use16Bit) {
+			const void * offset = reinterpret_cast<const void *>(r.m_first*m_indexesPerObject*sizeof(GLuint));
+			glDrawElements(m_primitiveType, r.m_count*m_indexesPerObject, GL_UNSIGNED_INT, offset);
+			continue;
+		}
+		unsigned int first = r.m_first;
+		unsigned int last = r.m_first + r.m_count;
+		while (first < last) {
+			unsigned int batchFirst = (first/m_objectsPerBatch)*m_objectsPerBatch;
+			unsigned int count = qMin(batchFirst + m_objectsPerBatch, last) - first;
+			const void * offset = reinterpret_cast<const void *>(first*m_indexesPerObject*sizeof(GLushort));
+			// indexes are relative to the first vertex of the batch
+			if (batchFirst == 0)
+				glDrawElements(m_primitiveType, count*m_indexesPerObject, GL_UNSIGNED_SHORT, offset);
+			else
+				m_drawElementsBaseVertex(m_primitiveType, count*m_indexesPerObject, GL_UNSIGNED_SHORT, offset,
+										 batchFirst*m_verticesPerObject);
+			first += count;
+		}
+	}
+
+	if (m_primitiveType != GL_TRIANGLES)
+		glDisable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+}
+
+
+unsigned int ElementBatches::memSize() const {
+	return m_use16Bit ? m_elements16.size()*sizeof(GLushort) : m_elements32.size()*sizeof(GLuint);
+}
@@ -0,0 +1,112 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef ELEMENTBATCHES_H
+#define ELEMENTBATCHES_H
+
+#include <QtGui/QOpenGLFunctions>
+
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+class QOpenGLBuffer;
+class QOpenGLTimeMonitor;
+QT_END_NAMESPACE
+
+/*! Index (element) data of a mesh made of many objects with the same number of vertexes and indexes
+	each (e.g. boxes), split into draw batches with at most 65535 vertexes each.
+
+	Within a batch, indexes are stored relative to the first vertex of the batch, so that 16-bit
+	indexes (GL_UNSIGNED_SHORT) are sufficient. Each batch is drawn with glDrawElementsBaseVertex(),
+	which adds the index of the first vertex of the batch to each index (this also applies to
+	gl_VertexID, so shaders see the same vertex ids as with 32-bit indexes).
+
+	16-bit indexes are used automatically, if the mesh fits into a single batch or if
+	glDrawElementsBaseVertex() is available (OpenGL 3.2). Otherwise, the original 32-bit indexes
+	are used and all objects are drawn with a single glDrawElements() call.
+*/
+class ElementBatches {
+public:
+	/*! Maximum number of vertexes per batch; index 0xFFFF is not used, so that it remains
+		available as primitive restart index.
+	*/
+	static const unsigned int MaxBatchVertexCount = 65535;
+	/*! Primitive restart index in the 32-bit index data passed to setup(). It is converted to 0xFFFF for
+		16-bit indexes, since GL_PRIMITIVE_RESTART_FIXED_INDEX uses the largest value of the index type.
+	*/
+	static const GLuint RestartIndex = 0xFFFFFFFF;
+
+	/*! Determines index type and batch size and converts the index data. OpenGL context must be current.
+		\param elements 32-bit index data of all objects, indexes of object i must address only vertexes
+			i*verticesPerObject ... (i+1)*verticesPerObject-1 (or be RestartIndex)
+		\param verticesPerObject Number of vertexes per object.
+		\param indexesPerObject Number of indexes per object.
+		\param primitiveType GL_TRIANGLES or GL_TRIANGLE_STRIP. Strips must end with RestartIndex, so that
+			strips of consecutive objects are not connected.
+	*/
+	void setup(const std::vector<GLuint> & elements, unsigned int verticesPerObject, unsigned int indexesPerObject,
+			   GLenum primitiveType = GL_TRIANGLES);
+
+	/*! Copies index data into the element buffer (the buffer must be created and bound). */
+	void allocate(QOpenGLBuffer & ebo) const;
+
+	/*! Draws the triangles of objects 0...objectCount-1, batch by batch. The vertex array object
+		with the element buffer must be bound. For triangle strips, primitive restart is enabled while drawing.
+		If timeMonitor is given, a sample is recorded before the first batch and after each batch
+		(as long as the monitor has samples left), so that GPU time per batch can be evaluated.
+	*/
+	void draw(unsigned int objectCount, QOpenGLTimeMonitor * timeMonitor = nullptr) const;
+
+	/*! A range of consecutive objects. */
+	struct Range {
+		unsigned int	m_first;
+		unsigned int	m_count;
+	};
+
+	/*! Draws the objects in the given ranges (e.g. the visible parts of a scene). Ranges that span several
+		batches are split at the batch boundaries. The vertex array object with the element buffer must be bound.
+	*/
+	void drawRanges(const std::vector<Range> & ranges) const;
+
+	/*! Number of draw calls needed for objectCount objects. */
+	unsigned int batchCount(unsigned int objectCount) const {
+		if (!m_use16Bit)
+			return objectCount > 0 ? 1 : 0;
+		return (objectCount + m_objectsPerBatch - 1)/m_objectsPerBatch;
+	}
+
+	/*! Index type used in the element buffer, either GL_UNSIGNED_SHORT or GL_UNSIGNED_INT. */
+	GLenum indexType() const { return m_use16Bit ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT; }
+	/*! Size of index data in the element buffer in bytes. */
+	unsigned int memSize() const;
+
+	/*! If true, 16-bit indexes are used. */
+	bool					m_use16Bit = false;
+	/*! GL_TRIANGLES or GL_TRIANGLE_STRIP. */
+	GLenum					m_primitiveType = GL_TRIANGLES;
+	/*! Number of objects per batch. */
+	unsigned int			m_objectsPerBatch = 0;
+	unsigned int			m_verticesPerObject = 0;
+	unsigned int			m_indexesPerObject = 0;
+
+private:
+	typedef void (QOPENGLF_APIENTRYP DrawElementsBaseVertexFunc)(GLenum mode, GLsizei count, GLenum type,
+																 const void * indices, GLint basevertex);
+
+	/*! Batch-relative 16-bit indexes (if m_use16Bit is true). */
+	std::vector<GLushort>	m_elements16;
+	/*! Original 32-bit indexes (if m_use16Bit is false). */
+	std::vector<GLuint>		m_elements32;
+	/*! Resolved in setup(), nullptr if not available or not needed. */
+	DrawElementsBaseVertexFunc	m_drawElementsBaseVertex = nullptr;
+};
+
+#endif // ELEMENTBATCHES_H
@@ -29,6 +29,29 @@ contains( OPTIONS, sanitize_checks ) {
 	}
 }
 
+# Run benchmarks (see Benchmarks.cpp) instead of the application
+#OPTIONS += benchmarks
+contains( OPTIONS, benchmarks ) {
+	DEFINES += RUN_BENCHMARKS
+}
+
+# Use the general line-rectangle test intersectsRect() for picking instead of the test with precomputed face data
+#OPTIONS += legacy_rect_test
+contains( OPTIONS, legacy_rect_test ) {
+	DEFINES += LEGACY_RECT_TEST
+}
+
+# Enable AVX code path in the vectorized slab test (CPU must support AVX), otherwise SSE2 is used on x86
+#OPTIONS += avx
+contains( OPTIONS, avx ) {
+	linux-g++ | linux-g++-64 | macx {
+		QMAKE_CXXFLAGS *= -mavx
+	}
+	win32-msvc* {
+		QMAKE_CXXFLAGS *= /arch:AVX
+	}
+}
+
 # You can also make your code fail to compile if you use deprecated APIs.
 # In order to do so, uncomment the following line.
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
@@ -41,16 +64,31 @@ win32 {
 }
 
 SOURCES += \
+		Benchmarks.cpp \
+		BoxBounds.cpp \
+		BoxBVH.cpp \
+		BoxGrid.cpp \
+		BoxImporter.cpp \
+		BoxLOD.cpp \
 		BoxMesh.cpp \
 		BoxObject.cpp \
+		BoxStore.cpp \
+		DepthPyramid.cpp \
+		ElementBatches.cpp \
+		FrameUniformBuffer.cpp \
+		Frustum.cpp \
+		GPUCulling.cpp \
 		GridObject.cpp \
 		KeyboardMouseHandler.cpp \
+		MeshOptimizer.cpp \
 		OpenGLException.cpp \
 		OpenGLWindow.cpp \
+		PickFramebuffer.cpp \
 		PickLineObject.cpp \
 		PickObject.cpp \
 		PlaneMesh.cpp \
 		PlaneObject.cpp \
+		SceneCache.cpp \
 		SceneView.cpp \
 		ShaderProgram.cpp \
 		TestDialog.cpp \
@@ -59,18 +97,34 @@ SOURCES += \
 		main.cpp
 
 HEADERS += \
+	Benchmarks.h \
+	BoxBounds.h \
+	BoxBVH.h \
+	BoxGrid.h \
+	BoxImporter.h \
+	BoxLOD.h \
 	BoxMesh.h \
 	BoxObject.h \
+	BoxStore.h \
+	ElementBatches.h \
 	Camera.h \
 	DebugApplication.h \
+	DepthPyramid.h \
+	FrameUniformBuffer.h \
+	Frustum.h \
+	GPUCulling.h \
 	GridObject.h \
 	KeyboardMouseHandler.h \
+	MeshOptimizer.h \
 	OpenGLException.h \
 	OpenGLWindow.h \
+	Parallel.h \
+	PickFramebuffer.h \
 	PickLineObject.h \
 	PickObject.h \
 	PlaneMesh.h \
 	PlaneObject.h \
+	SceneCache.h \
 	SceneView.h \
 	ShaderProgram.h \
 	TestDialog.h \
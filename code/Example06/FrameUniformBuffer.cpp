@@ -0,0 +1,68 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "FrameUniformBuffer.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+
+#include <cstring>
+
+const char * const FrameUniformBuffer::BlockSourceFile = ":/shaders/FrameData.glsl";
+
+void FrameUniformBuffer::create() {
+	m_f = QOpenGLContext::currentContext()->extraFunctions();
+
+	m_f->glGenBuffers(1, &m_ubo);
+	m_f->glBindBuffer(GL_UNIFORM_BUFFER, m_ubo);
+	m_f->glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_DYNAMIC_DRAW);
+	m_f->glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	// the binding stays in place for the lifetime of the context, no need to bind the buffer before drawing
+	m_f->glBindBufferBase(GL_UNIFORM_BUFFER, BindingPoint, m_ubo);
+}
+
+
+void FrameUniformBuffer::destroy() {
+	if (m_f == nullptr)
+		return;
+	m_f->glDeleteBuffers(1, &m_ubo);
+	m_ubo = 0;
+	m_f = nullptr;
+}
+
+
+void FrameUniformBuffer::update(const QMatrix4x4 & worldToView, const QVector3D & cameraPos,
+								const QVector3D & lightPos, const QVector3D & lightColor)
+{
+	FrameData data;
+	// QMatrix4x4 stores its data column-major, just as std140 expects
+	std::memcpy(data.m_worldToView, worldToView.constData(), sizeof(data.m_worldToView));
+	for (int i=0; i<3; ++i) {
+		data.m_cameraPos[i] = cameraPos[i];
+		data.m_lightPos[i] = lightPos[i];
+		data.m_lightColor[i] = lightColor[i];
+	}
+	data.m_pad0 = data.m_pad1 = data.m_pad2 = 0;
+
+	m_f->glBindBuffer(GL_UNIFORM_BUFFER, m_ubo);
+	m_f->glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+	m_f->glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+
+void FrameUniformBuffer::bindUniformBlock(QOpenGLShaderProgram * program) {
+	QOpenGLExtraFunctions * f = QOpenGLContext::currentContext()->extraFunctions();
+	GLuint blockIndex = f->glGetUniformBlockIndex(program->programId(), "FrameData");
+	if (blockIndex != GL_INVALID_INDEX)
+		f->glUniformBlockBinding(program->programId(), blockIndex, BindingPoint);
+}
@@ -0,0 +1,78 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef FRAMEUNIFORMBUFFER_H
+#define FRAMEUNIFORMBUFFER_H
+
+#include <QtGui/QOpenGLFunctions>
+#include <QMatrix4x4>
+#include <QVector3D>
+
+QT_BEGIN_NAMESPACE
+class QOpenGLExtraFunctions;
+class QOpenGLShaderProgram;
+QT_END_NAMESPACE
+
+/*! A uniform buffer object with the data that is the same for all shader programs in a frame:
+	camera matrix and position, light position and color.
+
+	Instead of setting these uniforms in each shader program separately, update() writes them once
+	per frame into the buffer. The uniform block "FrameData" (std140 layout) is declared only once,
+	in BlockSourceFile. ShaderProgram::create() inserts this declaration into every shader, and
+	bindUniformBlock() connects the block with the buffer bound to binding point BindingPoint.
+
+	Like all other objects, the OpenGL resources must be released by calling destroy()
+	(with the OpenGL context being current).
+*/
+class FrameUniformBuffer {
+public:
+	/*! Uniform buffer binding point, used by the "FrameData" block of all shader programs. */
+	static const GLuint BindingPoint = 0;
+	/*! Resource path of the GLSL declaration of the uniform block "FrameData". */
+	static const char * const BlockSourceFile;
+
+	/*! Creates the buffer and binds it to BindingPoint, OpenGL context must be current. */
+	void create();
+	/*! Destroys OpenGL resources, OpenGL context must be current. */
+	void destroy();
+
+	/*! Writes the per-frame data into the buffer (single glBufferSubData() call). */
+	void update(const QMatrix4x4 & worldToView, const QVector3D & cameraPos, const QVector3D & lightPos, const QVector3D & lightColor);
+
+	/*! Connects the uniform block "FrameData" of the linked shader program with BindingPoint.
+		Shader programs without this block are left unchanged.
+	*/
+	static void bindUniformBlock(QOpenGLShaderProgram * program);
+
+private:
+	/*! Memory layout of the uniform block according to std140 rules: matrixes are stored column-major
+		as 4 vec4 columns, vec3 members are aligned to 16 bytes, hence the padding floats.
+		Mind: must match the declaration in BlockSourceFile.
+
+		Memory layout: 16 floats (matrix) + 3 * 4 floats (vectors) = 28*4 = 112 Bytes
+	*/
+	struct FrameData {
+		float	m_worldToView[16];
+		float	m_cameraPos[3];
+		float	m_pad0;
+		float	m_lightPos[3];
+		float	m_pad1;
+		float	m_lightColor[3];
+		float	m_pad2;
+	};
+
+	QOpenGLExtraFunctions	*m_f = nullptr;
+
+	/*! Uniform buffer object. */
+	GLuint					m_ubo = 0;
+};
+
+#endif // FRAMEUNIFORMBUFFER_H
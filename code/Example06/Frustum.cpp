@@ -0,0 +1,52 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "Frustum.h"
+
+void Frustum::set(const QMatrix4x4 & worldToView) {
+	// a point is inside if -w <= x,y,z <= w in clip space, each condition gives one plane (Gribb/Hartmann)
+	QVector4D r0 = worldToView.row(0);
+	QVector4D r1 = worldToView.row(1);
+	QVector4D r2 = worldToView.row(2);
+	QVector4D r3 = worldToView.row(3);
+	m_planes[P_Left]	= r3 + r0;
+	m_planes[P_Right]	= r3 - r0;
+	m_planes[P_Bottom]	= r3 + r1;
+	m_planes[P_Top]		= r3 - r1;
+	m_planes[P_Near]	= r3 + r2;
+	m_planes[P_Far]		= r3 - r2;
+}
+
+
+Frustum Frustum::fromNDCRect(const QMatrix4x4 & worldToView, float left, float bottom, float right, float top) {
+	// scale and shift clip coordinates, so that the rectangle becomes -1..1 in NDC
+	float sx = 2/(right - left);
+	float sy = 2/(top - bottom);
+	QMatrix4x4 rectToNDC(
+		sx, 0,  0, -(left + right)/(right - left),
+		0,  sy, 0, -(bottom + top)/(top - bottom),
+		0,  0,  1, 0,
+		0,  0,  0, 1);
+	return Frustum(rectToNDC * worldToView);
+}
+
+
+bool Frustum::intersects(const QVector3D & minCorner, const QVector3D & maxCorner) const {
+	for (const QVector4D & p : m_planes) {
+		// the box corner farthest along the plane normal must be inside, otherwise the entire box is outside
+		float x = p.x() >= 0 ? maxCorner.x() : minCorner.x();
+		float y = p.y() >= 0 ? maxCorner.y() : minCorner.y();
+		float z = p.z() >= 0 ? maxCorner.z() : minCorner.z();
+		if ((x*p.x() + y*p.y()) + (z*p.z() + p.w()) < 0)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,60 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <QVector3D>
+#include <QVector4D>
+#include <QMatrix4x4>
+
+/*! The view frustum (or a part of it) described by six planes in world coordinates.
+
+	The planes are extracted from the world to view matrix (projection * camera * transform), with
+	normals pointing inwards, i.e. a point p is inside the frustum if
+	m_planes[i].x()*p.x() + m_planes[i].y()*p.y() + m_planes[i].z()*p.z() + m_planes[i].w() >= 0
+	for all planes.
+*/
+class Frustum {
+public:
+	/*! Indexes of the planes in m_planes. */
+	enum Planes {
+		P_Left,
+		P_Right,
+		P_Bottom,
+		P_Top,
+		P_Near,
+		P_Far,
+		NUM_P
+	};
+
+	Frustum() {}
+	/*! Creates frustum from world to view matrix. */
+	explicit Frustum(const QMatrix4x4 & worldToView) { set(worldToView); }
+
+	/*! Extracts planes from the world to view matrix. */
+	void set(const QMatrix4x4 & worldToView);
+
+	/*! Creates the part of the view frustum that is seen through the rectangle left...right, bottom...top,
+		given in normalized device coordinates (-1..1). Used for selecting objects within a rectangle.
+	*/
+	static Frustum fromNDCRect(const QMatrix4x4 & worldToView, float left, float bottom, float right, float top);
+
+	/*! Tests if an axis-aligned box (given by minimum and maximum corner) is at least partially within the frustum.
+		Mind: the test is conservative, large boxes near the frustum corners may be reported as intersecting
+		although they are outside.
+	*/
+	bool intersects(const QVector3D & minCorner, const QVector3D & maxCorner) const;
+
+	QVector4D	m_planes[NUM_P];
+};
+
+#endif // FRUSTUM_H
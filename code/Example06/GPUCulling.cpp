@@ -0,0 +1,162 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "GPUCulling.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+#include <QDebug>
+
+#include "BoxBounds.h"
+#include "ElementBatches.h"
+#include "Frustum.h"
+
+/*! Number of commands processed per work group, must match local_size_x in cullChunks.comp. */
+static const unsigned int WorkGroupSize = 64;
+
+bool GPUCulling::isSupported() {
+	QOpenGLContext * ctx = QOpenGLContext::currentContext();
+	return !ctx->isOpenGLES() && ctx->format().version() >= qMakePair(4, 3);
+}
+
+
+bool GPUCulling::create() {
+	Q_ASSERT(m_program == nullptr);
+	m_f = QOpenGLContext::currentContext()->extraFunctions();
+	m_multiDrawElementsIndirect = reinterpret_cast<MultiDrawElementsIndirectFunc>(
+				QOpenGLContext::currentContext()->getProcAddress("glMultiDrawElementsIndirect"));
+	if (m_multiDrawElementsIndirect == nullptr) {
+		qDebug() << "GPUCulling - glMultiDrawElementsIndirect not available";
+		return false;
+	}
+
+	m_program = new QOpenGLShaderProgram();
+	if (!m_program->addShaderFromSourceFile(QOpenGLShader::Compute, ":/shaders/cullChunks.comp") || !m_program->link()) {
+		qDebug() << "GPUCulling - Error compiling compute shader:" << m_program->log();
+		delete m_program;
+		m_program = nullptr;
+		return false;
+	}
+
+	m_f->glGenBuffers(1, &m_boundsBuffer);
+	m_f->glGenBuffers(1, &m_commandBuffer);
+	m_commandCount = 0;
+	return true;
+}
+
+
+void GPUCulling::destroy() {
+	if (m_program == nullptr)
+		return;
+	m_f->glDeleteBuffers(1, &m_commandBuffer);
+	m_f->glDeleteBuffers(1, &m_boundsBuffer);
+	delete m_program;
+	m_program = nullptr;
+	m_commandCount = 0;
+}
+
+
+void GPUCulling::setup(const BoxBounds & chunkBounds, unsigned int chunkSize, unsigned int objectCount,
+					   const ElementBatches & batches)
+{
+	m_commands.clear();
+	m_bounds.clear();
+	m_commandChunkIds.clear();
+	for (unsigned int chunkId=0; chunkId<chunkBounds.size(); ++chunkId) {
+		// split chunk at batch boundaries; with 32-bit indexes, all objects are in a single batch
+		unsigned int first = chunkId*chunkSize;
+		unsigned int last = qMin(first + chunkSize, objectCount);
+		while (first < last) {
+			unsigned int batchFirst = (first/batches.m_objectsPerBatch)*batches.m_objectsPerBatch;
+			unsigned int count = qMin(batchFirst + batches.m_objectsPerBatch, last) - first;
+			DrawElementsIndirectCommand cmd;
+			cmd.m_count = count*batches.m_indexesPerObject;
+			cmd.m_instanceCount = 1;
+			cmd.m_firstIndex = first*batches.m_indexesPerObject;
+			cmd.m_baseVertex = batches.m_use16Bit ? GLint(batchFirst*batches.m_verticesPerObject) : 0;
+			cmd.m_baseInstance = 0;
+			m_commands.push_back(cmd);
+			m_commandChunkIds.push_back(chunkId);
+			const GLfloat bounds[8] = {
+				chunkBounds.m_minX[chunkId], chunkBounds.m_minY[chunkId], chunkBounds.m_minZ[chunkId], 1,
+				chunkBounds.m_maxX[chunkId], chunkBounds.m_maxY[chunkId], chunkBounds.m_maxZ[chunkId], 1
+			};
+			m_bounds.insert(m_bounds.end(), bounds, bounds + 8);
+			first += count;
+		}
+	}
+	m_commandCount = m_commands.size();
+
+	m_f->glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_boundsBuffer);
+	m_f->glBufferData(GL_SHADER_STORAGE_BUFFER, m_bounds.size()*sizeof(GLfloat), m_bounds.data(), GL_DYNAMIC_DRAW);
+	m_f->glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandBuffer);
+	m_f->glBufferData(GL_SHADER_STORAGE_BUFFER, m_commands.size()*sizeof(DrawElementsIndirectCommand), m_commands.data(), GL_DYNAMIC_DRAW);
+	m_f->glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+
+void GPUCulling::draw(const Frustum & frustum, const ElementBatches & batches) {
+	if (m_commandCount == 0)
+		return;
+
+	cull(frustum);
+
+	// the commands must be written before they are read by the draw call
+	m_f->glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+
+	if (batches.m_primitiveType != GL_TRIANGLES)
+		m_f->glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+	m_f->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	m_multiDrawElementsIndirect(batches.m_primitiveType, batches.indexType(), nullptr, m_commandCount, 0);
+	m_f->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	if (batches.m_primitiveType != GL_TRIANGLES)
+		m_f->glDisable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+}
+
+
+void GPUCulling::cull(const Frustum & frustum) {
+	if (m_commandCount == 0)
+		return;
+
+	// the compute shader sets the instance count of each command
+	GLint renderProgram = 0;
+	m_f->glGetIntegerv(GL_CURRENT_PROGRAM, &renderProgram);
+	m_program->bind();
+	m_program->setUniformValueArray("frustumPlanes", frustum.m_planes, Frustum::NUM_P);
+	m_program->setUniformValue("commandCount", (GLuint)m_commandCount);
+	m_f->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_boundsBuffer);
+	m_f->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_commandBuffer);
+	m_f->glDispatchCompute((m_commandCount + WorkGroupSize - 1)/WorkGroupSize, 1, 1);
+	m_f->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+	m_f->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+	m_f->glUseProgram(renderProgram);
+}
+
+
+void GPUCulling::visibleChunks(std::vector<unsigned int> & chunkIds) {
+	chunkIds.clear();
+	if (m_commandCount == 0)
+		return;
+	// the commands must be written before they are mapped
+	m_f->glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	m_f->glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandBuffer);
+	const DrawElementsIndirectCommand * commands = reinterpret_cast<const DrawElementsIndirectCommand *>(
+				m_f->glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, m_commandCount*sizeof(DrawElementsIndirectCommand), GL_MAP_READ_BIT));
+	if (commands != nullptr) {
+		// a chunk spanning several batches has several commands, all with the same result
+		for (unsigned int i=0; i<m_commandCount; ++i)
+			if (commands[i].m_instanceCount != 0 && (chunkIds.empty() || chunkIds.back() != m_commandChunkIds[i]))
+				chunkIds.push_back(m_commandChunkIds[i]);
+		m_f->glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+	}
+	m_f->glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
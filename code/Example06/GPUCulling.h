@@ -0,0 +1,113 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef GPUCULLING_H
+#define GPUCULLING_H
+
+#include <QtGui/QOpenGLFunctions>
+
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+class QOpenGLExtraFunctions;
+class QOpenGLShaderProgram;
+QT_END_NAMESPACE
+
+class BoxBounds;
+class ElementBatches;
+class Frustum;
+
+/*! Frustum culling of chunks of objects on the GPU, with indirect draws (needs OpenGL 4.3).
+
+	For each chunk, a draw command (DrawElementsIndirectCommand) is stored in a buffer, together with
+	the chunk's bounding box. Chunks spanning several batches of an ElementBatches object get a command
+	per batch, with the base vertex of the batch. Each frame, a compute shader (shaders/cullChunks.comp)
+	tests the bounding boxes against the frustum planes and sets the instance count of each command to 1
+	(visible) or 0 (culled). All commands are then drawn with a single glMultiDrawElementsIndirect() call,
+	so the CPU neither tests the chunks nor issues a draw call per visible range.
+
+	The indirect draw commands never use instancing or base instances, so gl_VertexID and gl_InstanceID
+	in the vertex shaders are the same as with ElementBatches::draw().
+
+	Like all other objects, the OpenGL resources must be released by calling destroy()
+	(with the OpenGL context being current).
+*/
+class GPUCulling {
+public:
+	/*! Returns true, if the current context supports compute shaders and indirect multi-draws (OpenGL 4.3). */
+	static bool isSupported();
+
+	/*! Compiles the compute shader and creates the buffers, OpenGL context must be current.
+		Returns false (and leaves the object uncreated), if the compute shader cannot be compiled.
+	*/
+	bool create();
+	/*! Destroys OpenGL resources, OpenGL context must be current. */
+	void destroy();
+	/*! Returns true between successful create() and destroy(). */
+	bool isCreated() const { return m_program != nullptr; }
+
+	/*! Creates the draw commands and uploads them with the bounding boxes of the chunks.
+		\param chunkBounds Bounding boxes of the chunks.
+		\param chunkSize Number of objects per chunk (the last chunk may be smaller).
+		\param objectCount Total number of objects.
+		\param batches Element data of the objects, must be stored in the bound element buffer.
+	*/
+	void setup(const BoxBounds & chunkBounds, unsigned int chunkSize, unsigned int objectCount, const ElementBatches & batches);
+
+	/*! Culls the chunks against the frustum in the compute shader and draws the visible chunks. The vertex
+		array object with the element buffer must be bound. The currently bound shader program is bound again
+		after the culling pass.
+	*/
+	void draw(const Frustum & frustum, const ElementBatches & batches);
+
+	/*! Runs only the culling pass of draw(). The currently bound shader program is bound again afterwards. */
+	void cull(const Frustum & frustum);
+	/*! Reads back the result of the last culling pass and returns the (sorted) indexes of the visible chunks.
+		Waits for the GPU, meant for checking the compute shader against the culling on the CPU only.
+	*/
+	void visibleChunks(std::vector<unsigned int> & chunkIds);
+
+	/*! Number of draw commands (at least one per chunk). */
+	unsigned int commandCount() const { return m_commandCount; }
+
+private:
+	/*! Layout of a command in the indirect buffer, as defined by OpenGL. */
+	struct DrawElementsIndirectCommand {
+		GLuint	m_count;
+		GLuint	m_instanceCount;
+		GLuint	m_firstIndex;
+		GLint	m_baseVertex;
+		GLuint	m_baseInstance;
+	};
+
+	typedef void (QOPENGLF_APIENTRYP MultiDrawElementsIndirectFunc)(GLenum mode, GLenum type, const void * indirect,
+																	GLsizei drawcount, GLsizei stride);
+
+	QOpenGLExtraFunctions	*m_f = nullptr;
+	/*! Resolved in create(). */
+	MultiDrawElementsIndirectFunc	m_multiDrawElementsIndirect = nullptr;
+	/*! The compute shader program. */
+	QOpenGLShaderProgram	*m_program = nullptr;
+
+	/*! Shader storage buffer with minimum and maximum corner (vec4 each) per command. */
+	GLuint					m_boundsBuffer = 0;
+	/*! Draw commands, written by the compute shader (shader storage buffer) and read as indirect buffer. */
+	GLuint					m_commandBuffer = 0;
+	unsigned int			m_commandCount = 0;
+
+	/*! Buffer data, kept to avoid reallocations in setup(). */
+	std::vector<DrawElementsIndirectCommand>	m_commands;
+	std::vector<GLfloat>						m_bounds;
+	/*! Chunk index of each command. */
+	std::vector<unsigned int>					m_commandChunkIds;
+};
+
+#endif // GPUCULLING_H
@@ -0,0 +1,195 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+double averageCacheMissRatio(const GLuint * indexes, unsigned int indexCount, unsigned int cacheSize) {
+	if (indexCount < 3)
+		return 0;
+	// FIFO cache as ring buffer, only vertexes not yet in the cache are inserted
+	std::vector<GLuint> cache(cacheSize, GLuint(-1));
+	unsigned int next = 0;
+	unsigned int misses = 0;
+	for (unsigned int i=0; i<indexCount; ++i) {
+		if (std::find(cache.begin(), cache.end(), indexes[i]) != cache.end())
+			continue;
+		++misses;
+		cache[next] = indexes[i];
+		next = (next + 1) % cacheSize;
+	}
+	return double(misses)/(indexCount/3);
+}
+
+
+/*! Size of the simulated LRU cache in the vertex cache optimisation. */
+static const int ForsythCacheSize = 32;
+
+/*! Vertex score: vertexes recently used are preferred (but not those of the very last triangle, which
+	would produce long thin strips), as well as vertexes with few remaining triangles, so that no
+	isolated triangles are left over.
+*/
+static float forsythVertexScore(int cachePos, unsigned int remainingTriangles) {
+	if (remainingTriangles == 0)
+		return -1;
+	float score = 0;
+	if (cachePos >= 0) {
+		if (cachePos < 3)
+			score = 0.75f;
+		else
+			score = std::pow(1.f - float(cachePos - 3)/(ForsythCacheSize - 3), 1.5f);
+	}
+	return score + 2.f/std::sqrt(float(remainingTriangles));
+}
+
+
+void optimizeVertexCache(GLuint * indexes, unsigned int indexCount) {
+	const unsigned int triCount = indexCount/3;
+	if (triCount < 2)
+		return;
+
+	// work with vertex numbers relative to the smallest vertex index
+	GLuint firstVertex = *std::min_element(indexes, indexes + indexCount);
+	unsigned int vertexCount = *std::max_element(indexes, indexes + indexCount) - firstVertex + 1;
+
+	// triangles using each vertex (vertex v uses vertexTris[triOffsets[v]...triOffsets[v+1]-1])
+	std::vector<unsigned int> triOffsets(vertexCount + 1, 0);
+	for (unsigned int i=0; i<indexCount; ++i)
+		++triOffsets[indexes[i] - firstVertex + 1];
+	for (unsigned int v=0; v<vertexCount; ++v)
+		triOffsets[v + 1] += triOffsets[v];
+	std::vector<unsigned int> vertexTris(indexCount);
+	std::vector<unsigned int> remaining(vertexCount, 0);
+	for (unsigned int i=0; i<indexCount; ++i) {
+		unsigned int v = indexes[i] - firstVertex;
+		vertexTris[triOffsets[v] + remaining[v]++] = i/3;
+	}
+
+	std::vector<int> cachePos(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (unsigned int v=0; v<vertexCount; ++v)
+		vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+	std::vector<float> triScore(triCount);
+	for (unsigned int t=0; t<triCount; ++t)
+		triScore[t] = vertexScore[indexes[3*t] - firstVertex] + vertexScore[indexes[3*t+1] - firstVertex]
+				+ vertexScore[indexes[3*t+2] - firstVertex];
+
+	std::vector<bool> triAdded(triCount, false);
+	std::vector<GLuint> newIndexes;
+	newIndexes.reserve(indexCount);
+	// LRU cache, most recently used vertex first; may temporarily hold 3 more vertexes than the cache size
+	std::vector<unsigned int> cache;
+	cache.reserve(ForsythCacheSize + 3);
+
+	int bestTri = int(std::max_element(triScore.begin(), triScore.end()) - triScore.begin());
+	for (unsigned int n=0; n<triCount; ++n) {
+		// no candidate among the triangles of the cached vertexes, take best remaining triangle
+		if (bestTri == -1) {
+			float bestScore = -1;
+			for (unsigned int t=0; t<triCount; ++t) {
+				if (!triAdded[t] && triScore[t] > bestScore) {
+					bestScore = triScore[t];
+					bestTri = (int)t;
+				}
+			}
+		}
+
+		triAdded[bestTri] = true;
+		for (unsigned int j=0; j<3; ++j) {
+			GLuint idx = indexes[3*bestTri + j];
+			newIndexes.push_back(idx);
+			unsigned int v = idx - firstVertex;
+			--remaining[v];
+			// move triangle to end of remaining triangle list, so that only the first 'remaining' entries are open
+			unsigned int * first = &vertexTris[triOffsets[v]];
+			std::swap(*std::find(first, first + remaining[v] + 1, (unsigned int)bestTri), first[remaining[v]]);
+			// move vertex to front of cache
+			std::vector<unsigned int>::iterator it = std::find(cache.begin(), cache.end(), v);
+			if (it != cache.end())
+				cache.erase(it);
+			cache.insert(cache.begin(), v);
+		}
+
+		// update scores of cached vertexes and vertexes dropped out of the cache (at the end of the list)
+		for (unsigned int i=0; i<cache.size(); ++i)
+			cachePos[cache[i]] = i < (unsigned int)ForsythCacheSize ? (int)i : -1;
+
+		bestTri = -1;
+		float bestScore = -1;
+		for (unsigned int v : cache) {
+			vertexScore[v] = forsythVertexScore(cachePos[v], remaining[v]);
+			for (unsigned int k=0; k<remaining[v]; ++k) {
+				unsigned int t = vertexTris[triOffsets[v] + k];
+				triScore[t] = vertexScore[indexes[3*t] - firstVertex] + vertexScore[indexes[3*t+1] - firstVertex]
+						+ vertexScore[indexes[3*t+2] - firstVertex];
+				if (triScore[t] > bestScore) {
+					bestScore = triScore[t];
+					bestTri = (int)t;
+				}
+			}
+		}
+		if (cache.size() > (unsigned int)ForsythCacheSize)
+			cache.resize(ForsythCacheSize);
+	}
+
+	std::copy(newIndexes.begin(), newIndexes.end(), indexes);
+}
+
+
+void optimizeVertexCache(std::vector<GLuint> & indexes, unsigned int indexesPerObject) {
+	Q_ASSERT(indexes.size() % indexesPerObject == 0);
+	for (unsigned int i=0; i<indexes.size(); i += indexesPerObject)
+		optimizeVertexCache(indexes.data() + i, indexesPerObject);
+}
+
+
+/*! Spreads the lower 10 bits of v, so that there are two zero bits between each bit. */
+static quint32 spreadBits(quint32 v) {
+	v = (v | (v << 16)) & 0x030000FF;
+	v = (v | (v <<  8)) & 0x0300F00F;
+	v = (v | (v <<  4)) & 0x030C30C3;
+	v = (v | (v <<  2)) & 0x09249249;
+	return v;
+}
+
+
+std::vector<unsigned int> mortonOrder(const std::vector<QVector3D> & points) {
+	std::vector<unsigned int> order(points.size());
+	if (points.empty())
+		return order;
+
+	QVector3D minCorner = points[0];
+	QVector3D maxCorner = points[0];
+	for (const QVector3D & p : points) {
+		for (int j=0; j<3; ++j) {
+			minCorner[j] = std::min(minCorner[j], p[j]);
+			maxCorner[j] = std::max(maxCorner[j], p[j]);
+		}
+	}
+
+	// quantize coordinates to 10 bits and interleave them; the point index goes into the lower 32 bits
+	std::vector<quint64> keys(points.size());
+	for (unsigned int i=0; i<points.size(); ++i) {
+		quint32 code = 0;
+		for (int j=0; j<3; ++j) {
+			float extent = maxCorner[j] - minCorner[j];
+			quint32 q = extent > 0 ? quint32((points[i][j] - minCorner[j])/extent*1023.f) : 0;
+			code |= spreadBits(q) << (2 - j);
+		}
+		keys[i] = (quint64(code) << 32) | i;
+	}
+	std::sort(keys.begin(), keys.end());
+	for (unsigned int i=0; i<points.size(); ++i)
+		order[i] = (unsigned int)(keys[i] & 0xFFFFFFFF);
+	return order;
+}
@@ -0,0 +1,42 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <QtGui/QOpenGLFunctions>
+#include <QVector3D>
+
+#include <vector>
+
+/*! Average cache miss ratio (ACMR), i.e. number of vertex shader invocations per triangle, for
+	triangle list indexes drawn with a post-transform vertex cache of cacheSize vertexes (FIFO).
+	The optimum is about 0.5 for large regular meshes, and 2 for quads without shared vertexes.
+*/
+double averageCacheMissRatio(const GLuint * indexes, unsigned int indexCount, unsigned int cacheSize = 16);
+
+/*! Reorders the triangles of a triangle list, so that vertexes are reused while they are still in
+	the post-transform vertex cache (Tom Forsyth's linear-speed vertex cache optimisation).
+	Triangles keep their vertex order, so that the winding does not change.
+*/
+void optimizeVertexCache(GLuint * indexes, unsigned int indexCount);
+
+/*! Same as above, but reorders the triangles of each object (indexesPerObject indexes each)
+	separately, so that objects remain consecutive in the index buffer (see ElementBatches).
+*/
+void optimizeVertexCache(std::vector<GLuint> & indexes, unsigned int indexesPerObject);
+
+/*! Returns the permutation, that sorts the points along a Morton (z-order) curve. Points close
+	to each other in space are then mostly close to each other in the sorted sequence.
+*/
+std::vector<unsigned int> mortonOrder(const std::vector<QVector3D> & points);
+
+#endif // MESHOPTIMIZER_H
@@ -0,0 +1,53 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+
+/*! Wraps a function object into a runnable to be executed by a QThreadPool (Qt < 5.15 has no QRunnable::create()). */
+template <typename Func>
+class FunctionRunnable : public QRunnable {
+public:
+	explicit FunctionRunnable(Func f) : m_func(f) {}
+	void run() override { m_func(); }
+private:
+	Func m_func;
+};
+
+template <typename Func>
+QRunnable * createRunnable(Func f) {
+	return new FunctionRunnable<Func>(f);
+}
+
+
+/*! Calls f(chunk) for all chunks 0...chunkCount-1 and returns when all chunks are done.
+	Chunks 1...n are processed by the global thread pool, chunk 0 by the calling thread.
+*/
+template <typename Func>
+void processChunksInParallel(unsigned int chunkCount, Func f) {
+	if (chunkCount == 0)
+		return;
+	QSemaphore chunksDone;
+	for (unsigned int chunk=1; chunk<chunkCount; ++chunk) {
+		QThreadPool::globalInstance()->start(createRunnable([&f, &chunksDone, chunk]() {
+			f(chunk);
+			chunksDone.release();
+		}));
+	}
+	f(0);
+	chunksDone.acquire(chunkCount - 1);
+}
+
+#endif // PARALLEL_H
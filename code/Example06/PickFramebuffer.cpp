@@ -0,0 +1,133 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "PickFramebuffer.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QDebug>
+
+void PickFramebuffer::create() {
+	m_f = QOpenGLContext::currentContext()->extraFunctions();
+
+	m_f->glGenFramebuffers(1, &m_fbo);
+	m_f->glGenRenderbuffers(1, &m_colorBuffer);
+	m_f->glGenRenderbuffers(1, &m_depthBuffer);
+
+	// pixel buffer object, large enough for a single pixel with 4 unsigned int components
+	m_f->glGenBuffers(1, &m_pbo);
+	m_f->glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pbo);
+	m_f->glBufferData(GL_PIXEL_PACK_BUFFER, 4*sizeof(GLuint), nullptr, GL_STREAM_READ);
+	m_f->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_needsAllocation = true;
+}
+
+
+void PickFramebuffer::destroy() {
+	if (m_f == nullptr)
+		return;
+	if (m_fence != nullptr)
+		m_f->glDeleteSync(m_fence);
+	m_fence = nullptr;
+	m_f->glDeleteBuffers(1, &m_pbo);
+	m_f->glDeleteRenderbuffers(1, &m_depthBuffer);
+	m_f->glDeleteRenderbuffers(1, &m_colorBuffer);
+	m_f->glDeleteFramebuffers(1, &m_fbo);
+	m_f = nullptr;
+}
+
+
+void PickFramebuffer::resize(int width, int height) {
+	if (width == m_width && height == m_height)
+		return;
+	m_width = width;
+	m_height = height;
+	m_needsAllocation = true;
+}
+
+
+void PickFramebuffer::bind() {
+	m_f->glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+	if (m_needsAllocation)
+		allocate();
+
+	m_f->glViewport(0, 0, m_width, m_height);
+	// id 0 denotes the background
+	const GLuint clearIds[4] = {0, 0, 0, 0};
+	m_f->glClearBufferuiv(GL_COLOR, 0, clearIds);
+	m_f->glDepthMask(GL_TRUE);
+	m_f->glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+
+void PickFramebuffer::release() {
+	m_f->glBindFramebuffer(GL_FRAMEBUFFER, QOpenGLContext::currentContext()->defaultFramebufferObject());
+}
+
+
+void PickFramebuffer::readPixel(int x, int y) {
+	if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+		return;
+	// discard a result not yet fetched
+	if (m_fence != nullptr)
+		m_f->glDeleteSync(m_fence);
+
+	// with a bound pixel pack buffer, glReadPixels() returns immediately and the data is copied on the GPU
+	m_f->glReadBuffer(GL_COLOR_ATTACHMENT0);
+	m_f->glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pbo);
+	m_f->glReadPixels(x, y, 1, 1, GL_RGBA_INTEGER, GL_UNSIGNED_INT, nullptr);
+	m_f->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	m_fence = m_f->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+
+bool PickFramebuffer::fetchResult(unsigned int & objectType, unsigned int & objectId, unsigned int & faceId) {
+	if (m_fence == nullptr)
+		return false;
+	// poll only, do not wait for the GPU
+	GLenum res = m_f->glClientWaitSync(m_fence, 0, 0);
+	if (res != GL_ALREADY_SIGNALED && res != GL_CONDITION_SATISFIED)
+		return false;
+	m_f->glDeleteSync(m_fence);
+	m_fence = nullptr;
+
+	m_f->glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pbo);
+	const GLuint * ids = reinterpret_cast<const GLuint *>(
+		m_f->glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, 4*sizeof(GLuint), GL_MAP_READ_BIT));
+	bool success = (ids != nullptr);
+	if (success) {
+		objectType = ids[0];
+		objectId = ids[1];
+		faceId = ids[2];
+		m_f->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	m_f->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	return success;
+}
+
+
+void PickFramebuffer::allocate() {
+	qDebug() << "Creating pick framebuffer with size " << m_width << "x" << m_height;
+
+	m_f->glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+	m_f->glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA32UI, m_width, m_height);
+	m_f->glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	m_f->glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_width, m_height);
+	m_f->glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	m_f->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+	m_f->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+
+	if (m_f->glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		qWarning() << "Pick framebuffer is incomplete.";
+	m_needsAllocation = false;
+}
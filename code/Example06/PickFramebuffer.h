@@ -0,0 +1,86 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef PICKFRAMEBUFFER_H
+#define PICKFRAMEBUFFER_H
+
+#include <QtGui/QOpenGLFunctions>
+
+QT_BEGIN_NAMESPACE
+class QOpenGLExtraFunctions;
+QT_END_NAMESPACE
+
+/*! An offscreen framebuffer with an integer color attachment (GL_RGBA32UI) and a depth buffer,
+	used for picking by rendering object and face ids into the color attachment.
+
+	QOpenGLFramebufferObject (as used in Tutorial_09) cannot allocate integer color
+	attachments, hence the framebuffer is created with plain OpenGL calls.
+
+	The pixel under the cursor is read back asynchronously: readPixel() copies the pixel
+	into a pixel buffer object and inserts a fence, fetchResult() returns the ids once
+	the GPU has passed the fence. This way, the CPU never waits for the GPU.
+
+	Like all other objects, the OpenGL resources must be released by calling destroy()
+	(with the OpenGL context being current).
+*/
+class PickFramebuffer {
+public:
+	/*! Creates framebuffer and pixel buffer object, OpenGL context must be current. */
+	void create();
+	/*! Destroys OpenGL resources, OpenGL context must be current. */
+	void destroy();
+
+	/*! Sets new framebuffer size (in pixels). The attachments are re-allocated in the next call
+		to bind(), so that this function can be called from resizeGL(), even if the context is not current.
+	*/
+	void resize(int width, int height);
+
+	/*! Binds the framebuffer and clears color (ids = 0 = background) and depth attachments. */
+	void bind();
+	/*! Binds the default framebuffer of the current context again. */
+	void release();
+
+	/*! Starts the read back of the ids at pixel x, y (OpenGL convention, y = 0 is the bottom row).
+		The framebuffer must still be bound.
+	*/
+	void readPixel(int x, int y);
+
+	/*! Returns true, if a pixel read is in progress. */
+	bool pending() const { return m_fence != nullptr; }
+
+	/*! If the pixel data requested with readPixel() is available, returns true and stores the ids
+		rendered at the pixel. Returns false if the GPU is not yet done (try again next frame).
+		An objectType of 0 means that the background was hit.
+	*/
+	bool fetchResult(unsigned int & objectType, unsigned int & objectId, unsigned int & faceId);
+
+private:
+	/*! Allocates storage of the render buffers with current size. */
+	void allocate();
+
+	QOpenGLExtraFunctions	*m_f = nullptr;
+
+	GLuint					m_fbo = 0;
+	/*! Render buffer with ids (GL_RGBA32UI). */
+	GLuint					m_colorBuffer = 0;
+	GLuint					m_depthBuffer = 0;
+	/*! Pixel buffer object that receives the picked pixel. */
+	GLuint					m_pbo = 0;
+	/*! Fence inserted after the read back, nullptr if no read is in progress. */
+	GLsync					m_fence = nullptr;
+
+	int						m_width = 0;
+	int						m_height = 0;
+	/*! If true, render buffers need to be (re-)allocated in next call to bind(). */
+	bool					m_needsAllocation = true;
+};
+
+#endif // PICKFRAMEBUFFER_H
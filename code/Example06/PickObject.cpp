@@ -82,3 +82,43 @@ bool intersectsRect(const QVector3D & a,
 	return false;
 }
 
+
+
+PickCacheKey::PickCacheKey() :
+	m_devicePixelRatio(0),
+	m_generation(0)
+{
+	for (int i=0; i<16; ++i)
+		m_worldToView[i] = 0;
+}
+
+
+PickCacheKey::PickCacheKey(const QMatrix4x4 & worldToView, const QSize & viewSize, qreal devicePixelRatio,
+						   const QPoint & pixel, unsigned int generation) :
+	m_viewSize(viewSize),
+	m_devicePixelRatio(devicePixelRatio),
+	m_pixel(pixel),
+	m_generation(generation)
+{
+	// 1e-4 resolution is well below anything that changes the clicked pixel
+	const float * m = worldToView.constData();
+	for (int i=0; i<16; ++i)
+		m_worldToView[i] = qRound(m[i]*1e4f);
+}
+
+
+bool PickCacheKey::sameView(const PickCacheKey & other) const {
+	if (m_viewSize != other.m_viewSize || m_devicePixelRatio != other.m_devicePixelRatio || m_generation != other.m_generation)
+		return false;
+	for (int i=0; i<16; ++i)
+		if (m_worldToView[i] != other.m_worldToView[i])
+			return false;
+	return true;
+}
+
+
+uint qHash(const PickCacheKey & key, uint seed) {
+	uint h = qHashBits(key.m_worldToView, sizeof(key.m_worldToView), seed);
+	h ^= qHash(key.m_viewSize.width(), seed) ^ (qHash(key.m_viewSize.height(), seed) << 8);
+	return h ^ qHash(key.m_pixel.x(), seed) ^ (qHash(key.m_pixel.y(), seed) << 16) ^ qHash(key.m_generation, seed);
+}
@@ -2,6 +2,10 @@
 #define PICKOBJECT_H
 
 #include <QVector3D>
+#include <QMatrix4x4>
+#include <QPoint>
+#include <QSize>
+#include <QHash>
 
 /*! An Object to hold information on the clicked-on object. */
 struct PickObject {
@@ -20,6 +24,34 @@ struct PickObject {
 };
 
 
+/*! Key for caching pick results: a pick result remains valid, as long as the camera (world to view matrix),
+	the view size and device pixel ratio (both determine the pick line through a pixel), the clicked pixel
+	and the scene geometry (identified through a generation counter) are the same.
+*/
+struct PickCacheKey {
+	PickCacheKey();
+	PickCacheKey(const QMatrix4x4 & worldToView, const QSize & viewSize, qreal devicePixelRatio,
+				 const QPoint & pixel, unsigned int generation);
+
+	/*! Returns true, if both keys have the same camera, view size, device pixel ratio and generation,
+		i.e. differ at most by the clicked pixel.
+	*/
+	bool sameView(const PickCacheKey & other) const;
+	bool operator==(const PickCacheKey & other) const { return m_pixel == other.m_pixel && sameView(other); }
+
+	/*! Coefficients of world to view matrix, quantised to integers so that keys can be compared exactly. */
+	qint32			m_worldToView[16];
+	/*! Widget size in logical pixels. */
+	QSize			m_viewSize;
+	qreal			m_devicePixelRatio;
+	/*! Clicked pixel in logical widget coordinates. */
+	QPoint			m_pixel;
+	unsigned int	m_generation;
+};
+
+uint qHash(const PickCacheKey & key, uint seed = 0);
+
+
 /*! Tests if a line (with equation p = p1 + t * d) hits a plane, defined by
 	p = x * a  +  y * b. Returns true if intersection is found, and returns
 	the normalized distance (t) between intersection point and point p1.
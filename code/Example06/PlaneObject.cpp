@@ -92,9 +92,10 @@ void PlaneObject::create(QOpenGLShaderProgram * shaderProgramm) {
 	m_ebo.create();
 	m_ebo.bind();
 	m_ebo.setUsagePattern(QOpenGLBuffer::StaticDraw);
-	int elementMemSize = m_elementBufferData.size()*sizeof(GLuint);
+	m_elementBatches.setup(m_elementBufferData, PlaneMesh::VertexCount, PlaneMesh::IndexCount);
+	int elementMemSize = m_elementBatches.memSize();
 	qDebug() << "PlaneObject - ElementBuffer size =" << elementMemSize/1024.0 << "kByte";
-	m_ebo.allocate(m_elementBufferData.data(), elementMemSize);
+	m_elementBatches.allocate(m_ebo);
 
 	// set shader attributes
 	// tell shader program we have two data arrays to be used as input to the shaders
@@ -126,7 +127,7 @@ void PlaneObject::render() {
 
 	// now draw the cube by drawing individual triangles
 	// - GL_TRIANGLES - draw individual triangles via elements
-	glDrawElements(GL_TRIANGLES, m_elementBufferData.size(), GL_UNSIGNED_INT, nullptr);
+	m_elementBatches.draw(m_planes.size());
 	// release vertices again
 	m_vao.release();
 }
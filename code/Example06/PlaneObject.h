@@ -20,6 +20,7 @@ class QOpenGLShaderProgram;
 QT_END_NAMESPACE
 
 #include "PlaneMesh.h"
+#include "ElementBatches.h"
 
 /*! A container for transparent planes.
 */
@@ -45,6 +46,8 @@ public:
 	QOpenGLBuffer				m_vbo;
 	/*! Holds elements. */
 	QOpenGLBuffer				m_ebo;
+	/*! Index data in m_ebo, split into batches with 16-bit indexes where possible. */
+	ElementBatches				m_elementBatches;
 };
 
 #endif // PlaneObjectH
@@ -0,0 +1,166 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "SceneCache.h"
+
+#include <QSaveFile>
+#include <QDebug>
+
+#include <cstring>
+
+#include "BoxStore.h"
+
+static const char Magic[8] = {'B','O','X','S','C','E','N','E'};
+
+/*! Blobs start at multiples of this number of bytes. */
+static const quint64 BlobAlignment = 16;
+
+static quint64 alignedOffset(quint64 offset) {
+	return (offset + BlobAlignment - 1)/BlobAlignment*BlobAlignment;
+}
+
+
+quint64 SceneCache::hash(const void * data, size_t size, quint64 h) {
+	const unsigned char * bytes = reinterpret_cast<const unsigned char*>(data);
+	for (size_t i=0; i<size; ++i) {
+		h ^= bytes[i];
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+
+void SceneCache::blobSizes(unsigned int boxCount, quint64 sizes[NUM_B]) {
+	sizes[B_BoxVertices] = quint64(boxCount)*8*sizeof(QVector3D);
+	sizes[B_BoxPlaneInfo] = quint64(boxCount)*6*sizeof(BoxMesh::Rect);
+	sizes[B_BoxColors] = quint64(boxCount)*6*sizeof(QRgb);
+	sizes[B_Vertexes] = quint64(boxCount)*BoxMesh::VertexCount*sizeof(VertexPNC);
+	sizes[B_Elements] = quint64(boxCount)*BoxMesh::IndexCount*sizeof(GLuint);
+	sizes[B_Instances] = quint64(boxCount)*sizeof(BoxInstance);
+}
+
+
+bool SceneCache::write(const QString & fileName, quint64 contentHash, const BoxStore & boxes,
+					   const std::vector<VertexPNC> & vertexes, const std::vector<GLuint> & elements,
+					   const std::vector<BoxInstance> & instances)
+{
+	Q_ASSERT(vertexes.size() == boxes.size()*BoxMesh::VertexCount);
+	Q_ASSERT(elements.size() == boxes.size()*BoxMesh::IndexCount);
+	Q_ASSERT(instances.size() == boxes.size());
+
+	Header header;
+	std::memset(&header, 0, sizeof(Header));
+	std::memcpy(header.m_magic, Magic, sizeof(Magic));
+	header.m_version = Version;
+	header.m_boxCount = boxes.size();
+	header.m_contentHash = contentHash;
+	blobSizes(boxes.size(), header.m_sizes);
+	quint64 offset = sizeof(Header);
+	for (int b=0; b<NUM_B; ++b) {
+		header.m_offsets[b] = alignedOffset(offset);
+		offset = header.m_offsets[b] + header.m_sizes[b];
+	}
+
+	const void * blobData[NUM_B] = {
+		boxes.m_vertices.data(), boxes.m_planeInfo.data(), boxes.m_colors.data(),
+		vertexes.data(), elements.data(), instances.data()
+	};
+
+	// QSaveFile writes into a temporary file, which replaces the cache file in commit(); a cache file
+	// is therefore never incomplete, even if the application is terminated while writing
+	QSaveFile file(fileName);
+	if (!file.open(QIODevice::WriteOnly)) {
+		qDebug() << "SceneCache - cannot write" << fileName << ":" << file.errorString();
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	const char padding[BlobAlignment] = {0};
+	for (int b=0; b<NUM_B; ++b) {
+		file.write(padding, header.m_offsets[b] - file.pos());
+		file.write(reinterpret_cast<const char*>(blobData[b]), header.m_sizes[b]);
+	}
+	if (!file.commit()) {
+		qDebug() << "SceneCache - cannot write" << fileName << ":" << file.errorString();
+		return false;
+	}
+	return true;
+}
+
+
+bool SceneCache::open(const QString & fileName, quint64 contentHash) {
+	close();
+	m_file.setFileName(fileName);
+	if (!m_file.open(QIODevice::ReadOnly))
+		return false;
+
+	quint64 fileSize = m_file.size();
+	if (fileSize < sizeof(Header)) {
+		close();
+		return false;
+	}
+	m_data = m_file.map(0, fileSize);
+	if (m_data == nullptr) {
+		qDebug() << "SceneCache - cannot map" << fileName << ":" << m_file.errorString();
+		close();
+		return false;
+	}
+	m_header = reinterpret_cast<const Header*>(m_data);
+
+	if (std::memcmp(m_header->m_magic, Magic, sizeof(Magic)) != 0 || m_header->m_version != Version) {
+		qDebug() << "SceneCache -" << fileName << "is not a scene cache file of version" << Version;
+		close();
+		return false;
+	}
+	if (m_header->m_contentHash != contentHash) {
+		qDebug() << "SceneCache -" << fileName << "holds a different scene, content hash mismatch";
+		close();
+		return false;
+	}
+	// all blobs must have the expected size and must be inside the file
+	quint64 sizes[NUM_B];
+	blobSizes(m_header->m_boxCount, sizes);
+	for (int b=0; b<NUM_B; ++b) {
+		if (m_header->m_sizes[b] != sizes[b] || m_header->m_offsets[b] % BlobAlignment != 0 ||
+			m_header->m_offsets[b] > fileSize || sizes[b] > fileSize - m_header->m_offsets[b])
+		{
+			qDebug() << "SceneCache -" << fileName << "is corrupt";
+			close();
+			return false;
+		}
+	}
+	return true;
+}
+
+
+void SceneCache::close() {
+	if (m_data != nullptr)
+		m_file.unmap(m_data);
+	m_data = nullptr;
+	m_header = nullptr;
+	m_file.close();
+}
+
+
+void SceneCache::read(BoxStore & boxes, std::vector<GLuint> & elements, std::vector<BoxInstance> & instances) const {
+	Q_ASSERT(isOpen());
+	unsigned int n = m_header->m_boxCount;
+	const QVector3D * vertices = reinterpret_cast<const QVector3D*>(blob(B_BoxVertices));
+	boxes.m_vertices.assign(vertices, vertices + n*8);
+	const BoxMesh::Rect * planeInfo = reinterpret_cast<const BoxMesh::Rect*>(blob(B_BoxPlaneInfo));
+	boxes.m_planeInfo.assign(planeInfo, planeInfo + n*6);
+	const QRgb * colors = reinterpret_cast<const QRgb*>(blob(B_BoxColors));
+	boxes.m_colors.assign(colors, colors + n*6);
+
+	const GLuint * elementData = reinterpret_cast<const GLuint*>(blob(B_Elements));
+	elements.assign(elementData, elementData + n*BoxMesh::IndexCount);
+	const BoxInstance * instanceData = reinterpret_cast<const BoxInstance*>(blob(B_Instances));
+	instances.assign(instanceData, instanceData + n);
+}
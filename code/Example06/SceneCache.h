@@ -0,0 +1,107 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef SCENECACHE_H
+#define SCENECACHE_H
+
+#include <QFile>
+#include <QtGui/QOpenGLFunctions>
+
+#include <vector>
+
+#include "Vertex.h"
+
+class BoxStore;
+
+/*! A binary file with the data of a generated box scene, so that the boxes need not be generated
+	again on the next start.
+
+	The file holds a header and the data blobs one after another (each blob starts at a multiple of
+	16 bytes): the arrays of the BoxStore, the vertex data (VertexPNC, 24 per box), the 32-bit element
+	data and the per-box instance data. Data is stored in native byte order and struct layout, so that
+	blobs can be used as they are. This is a local cache, not an exchange format.
+
+	The file is memory-mapped in open(). The vertex blob can then be passed directly to
+	QOpenGLBuffer::allocate() (see vertexes()), so that the operating system reads the file pages
+	right into the buffer upload. The remaining (small) blobs are copied with read().
+
+	The cache is valid for a given content hash only, which the caller computes from all input that
+	determines the scene (see hash()).
+*/
+class SceneCache {
+public:
+	/*! Incremented whenever the file layout or the layout of the stored structs changes. */
+	static const quint32 Version = 1;
+
+	/*! 64-bit FNV-1a hash of size bytes at data. Pass the previous result as h to hash several blocks of data. */
+	static quint64 hash(const void * data, size_t size, quint64 h = 14695981039346656037ull);
+
+	/*! Writes the cache file (the file is replaced only, if it was written completely).
+		Returns false on error.
+	*/
+	static bool write(const QString & fileName, quint64 contentHash, const BoxStore & boxes,
+					  const std::vector<VertexPNC> & vertexes, const std::vector<GLuint> & elements,
+					  const std::vector<BoxInstance> & instances);
+
+	~SceneCache() { close(); }
+
+	/*! Maps the cache file into memory. Returns false, if the file does not exist, does not match
+		the content hash or is not a valid cache file (in this case, the cache is closed).
+	*/
+	bool open(const QString & fileName, quint64 contentHash);
+	/*! Unmaps and closes the cache file. */
+	void close();
+	/*! Returns true, while the cache file is mapped. */
+	bool isOpen() const { return m_header != nullptr; }
+
+	/*! Number of boxes in the cache. */
+	unsigned int boxCount() const { return m_header->m_boxCount; }
+	/*! Copies the box data, the element data and the instance data from the cache. */
+	void read(BoxStore & boxes, std::vector<GLuint> & elements, std::vector<BoxInstance> & instances) const;
+	/*! Vertex data of all boxes (boxCount()*BoxMesh::VertexCount vertexes), points into the mapped file. */
+	const VertexPNC * vertexes() const { return reinterpret_cast<const VertexPNC*>(blob(B_Vertexes)); }
+
+private:
+	/*! Data blobs, in the order of appearance in the file. */
+	enum Blob {
+		B_BoxVertices,
+		B_BoxPlaneInfo,
+		B_BoxColors,
+		B_Vertexes,
+		B_Elements,
+		B_Instances,
+		NUM_B
+	};
+
+	struct Header {
+		char		m_magic[8];
+		quint32		m_version;
+		quint32		m_boxCount;
+		quint64		m_contentHash;
+		/*! Start of the blobs in bytes, counted from the beginning of the file. */
+		quint64		m_offsets[NUM_B];
+		/*! Size of the blobs in bytes. */
+		quint64		m_sizes[NUM_B];
+	};
+
+	/*! Blob sizes in bytes for boxCount boxes. */
+	static void blobSizes(unsigned int boxCount, quint64 sizes[NUM_B]);
+
+	const uchar * blob(Blob b) const { return m_data + m_header->m_offsets[b]; }
+
+	QFile			m_file;
+	/*! Start of mapped file, nullptr while closed. */
+	uchar			*m_data = nullptr;
+	/*! Header at the start of the mapped file, nullptr while closed. */
+	const Header	*m_header = nullptr;
+};
+
+#endif // SCENECACHE_H
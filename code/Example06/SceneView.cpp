@@ -12,14 +12,24 @@ License    : BSD License,
 #include "SceneView.h"
 
 #include <QExposeEvent>
+#include <QKeyEvent>
 #include <QOpenGLShaderProgram>
 #include <QDateTime>
 
 #include "DebugApplication.h"
 #include "PickObject.h"
+#include "Frustum.h"
 
 #define SHADER(x) m_shaderPrograms[x].shaderProgram()
 
+/*! Object types written into the id buffer by the pickId shader. */
+enum PickObjectType {
+	PO_Background,
+	PO_Box,
+	PO_Plane,
+	PO_Text
+};
+
 SceneView::SceneView() :
 	m_inputEventReceived(false)
 {
@@ -35,35 +45,50 @@ SceneView::SceneView() :
 	// *** create scene (no OpenGL calls are being issued below, just the data structures are created.
 
 	// Shaderprogram #0 : regular geometry (painting triangles via element index)
+	// Mind: camera matrix and light parameters of all shader programs are passed in m_frameUniforms
 	ShaderProgram blocks(":/shaders/withWorldAndCamera.vert",":/shaders/simple.frag");
-	blocks.m_uniformNames.append("worldToView");
 	m_shaderPrograms.append( blocks );
 
 	// Shaderprogram #1 : grid (painting grid lines)
 	ShaderProgram grid(":/shaders/grid.vert",":/shaders/grid.frag");
-	grid.m_uniformNames.append("worldToView"); // mat4
 	grid.m_uniformNames.append("gridColor"); // vec3
 	grid.m_uniformNames.append("backColor"); // vec3
 	m_shaderPrograms.append( grid );
 
 	// Shaderprogram #2 : regular geometry with lighting
 	ShaderProgram lightedBlocks(":/shaders/VertexNormalColor.vert",":/shaders/diffuse.frag");
-	lightedBlocks.m_uniformNames.append("worldToView");
-	lightedBlocks.m_uniformNames.append("lightPos");
-	lightedBlocks.m_uniformNames.append("lightColor");
+	lightedBlocks.m_uniformNames.append("hoverBoxId");
+	lightedBlocks.m_uniformNames.append("hoverFaceId");
 	m_shaderPrograms.append( lightedBlocks );
 
 	// Shaderprogram #3 : transparent planes
 	ShaderProgram transPlanes(":/shaders/VertexColorTransparent.vert",":/shaders/simple.frag");
-	transPlanes.m_uniformNames.append("worldToView");
 	m_shaderPrograms.append( transPlanes );
 
 	// Shaderprogram #4 : planes with textures
 	ShaderProgram texturedPlanes(":/shaders/VertexFontTexture.vert",":/shaders/texture.frag");
-	texturedPlanes.m_uniformNames.append("worldToView");
 	texturedPlanes.m_uniformNames.append("text01"); // associate uniform index with texture name
 	m_shaderPrograms.append( texturedPlanes );
 
+	// Shaderprogram #5 : object and face ids for picking
+	ShaderProgram pickIds(":/shaders/pickId.vert",":/shaders/pickId.frag");
+	pickIds.m_uniformNames.append("objectType");
+	pickIds.m_uniformNames.append("verticesPerObject");
+	pickIds.m_uniformNames.append("instanced");
+	m_shaderPrograms.append( pickIds );
+
+	// Shaderprogram #6 : instanced boxes with lighting, same uniforms as #2
+	ShaderProgram instancedBlocks(":/shaders/VertexNormalColorInstanced.vert",":/shaders/diffuse.frag");
+	instancedBlocks.m_uniformNames.append("hoverBoxId");
+	instancedBlocks.m_uniformNames.append("hoverFaceId");
+	m_shaderPrograms.append( instancedBlocks );
+
+	// Shaderprogram #7 : boxes with shared corners and flat faces, same uniforms as #2
+	ShaderProgram sharedCornerBlocks(":/shaders/VertexColorSharedCorners.vert",":/shaders/diffuseFlat.frag");
+	sharedCornerBlocks.m_uniformNames.append("hoverBoxId");
+	sharedCornerBlocks.m_uniformNames.append("hoverFaceId");
+	m_shaderPrograms.append( sharedCornerBlocks );
+
 	// *** initialize camera placement and model placement in the world
 
 	// move camera a little back (mind: positive z) and look straight ahead
@@ -89,7 +114,11 @@ SceneView::~SceneView() {
 		m_planeObject.destroy();
 		m_textObject.destroy();
 
+		m_pickFramebuffer.destroy();
+		m_depthPyramid.destroy();
+		m_frameUniforms.destroy();
 		m_gpuTimers.destroy();
+		m_boxBatchTimers.destroy();
 	}
 }
 
@@ -97,7 +126,8 @@ SceneView::~SceneView() {
 void SceneView::initializeGL() {
 	FUNCID(SceneView::initializeGL);
 	try {
-		// initialize shader programs
+		// initialize per-frame uniform buffer and shader programs
+		m_frameUniforms.create();
 		for (ShaderProgram & p : m_shaderPrograms)
 			p.create();
 
@@ -105,7 +135,7 @@ void SceneView::initializeGL() {
 		glEnable(GL_DEPTH_TEST);
 
 		// initialize drawable objects
-		m_boxObject.create(SHADER(2));
+		m_boxObject.create(SHADER(boxShaderIndex()));
 		m_minorGridObject.create(SHADER(1), false);
 		m_majorGridObject.create(SHADER(1), true);
 		m_pickLineObject.create(SHADER(0));
@@ -116,9 +146,19 @@ void SceneView::initializeGL() {
 
 		m_textObject.create(m_shaderPrograms[4]);
 
+		m_pickFramebuffer.create();
+		m_depthPyramid.create();
+
+		// boxes from a file given on the command line are imported while the scene is shown
+		if (qApp->arguments().count() > 1)
+			importBoxes(qApp->arguments()[1]);
+
 		// Timer
 		m_gpuTimers.setSampleCount(5);
 		m_gpuTimers.create();
+		// enough for 1M boxes in batches of 2730 boxes, further batches are not timed
+		m_boxBatchTimers.setSampleCount(400);
+		m_boxBatchTimers.create();
 	}
 	catch (OpenGLException & ex) {
 		throw OpenGLException(ex, "OpenGL initialization failed.", FUNC_ID);
@@ -140,6 +180,11 @@ void SceneView::resizeGL(int width, int height) {
 
 	// update cached world2view matrix
 	updateWorld2ViewMatrix();
+
+	// id buffer and depth pyramid must match the size of the default framebuffer
+	const qreal retinaScale = devicePixelRatio();
+	m_pickFramebuffer.resize(width * retinaScale, height * retinaScale);
+	m_depthPyramid.resize(width * retinaScale, height * retinaScale);
 }
 
 
@@ -152,6 +197,45 @@ void SceneView::paintGL() {
 	if (m_inputEventReceived)
 		processInput();
 
+	QVector3D lightColor(1.f, 1.f, 1.f);
+
+	QVector3D lightPos(0.f, 2800.f, 1500.f);
+
+	m_rotationCounter = (m_rotationCounter + 1) % 1800;
+	QQuaternion lightRot = QQuaternion::fromAxisAndAngle(QVector3D(0,1,0), -0.2*m_rotationCounter);
+//	QQuaternion lightRot = QQuaternion::fromAxisAndAngle(QVector3D(0,1,0), 5*m_rotationCounter/180. * 3.1415);
+	lightPos = lightRot.rotatedVector(lightPos);
+//	qDebug() << lightPos;
+//	renderLater();
+
+	// camera and light data are the same for all shader programs, upload once for this frame
+	m_frameUniforms.update(m_worldToView, m_camera.translation(), lightPos, lightColor);
+
+	// id buffer picking: render id pass for pending pick request, and evaluate results from previous frames
+	if (m_pickRequested)
+		renderPickIds();
+	if (m_pickFramebuffer.pending())
+		processPickResult();
+
+	// move boxes and take over bounding volume hierarchy, if rebuilt in background meanwhile
+	if (m_animateBoxes) {
+		animateBoxes();
+		renderLater();
+	}
+	m_boxObject.pollBVHRebuild();
+
+	// add boxes imported so far
+	if (m_boxImporter.isRunning())
+		takeImportedBoxes();
+
+	// hover picking: all mouse moves since the last frame result in a single pick
+	if (m_hoverPending)
+		hoverPick();
+
+	// occlusion culling: take over the depth buffer of a previous frame, once read back
+	if (m_occlusionCulling && m_depthPyramid.pending() && m_depthPyramid.fetch())
+		m_depthPyramidGeneration = m_depthCaptureGeneration;
+
 	const qreal retinaScale = devicePixelRatio(); // needed for Macs with retina display
 	glViewport(0, 0, width() * retinaScale, height() * retinaScale);
 	qDebug() << "SceneView::paintGL(): Rendering to:" << width() << "x" << height();
@@ -172,18 +256,9 @@ void SceneView::paintGL() {
 
 	QVector3D minorGridColor(0.5f, 0.5f, 0.7f);
 	QVector3D majorGridColor(0.8f, 0.8f, 1.0f);
-	QVector3D lightColor(1.f, 1.f, 1.f);
-
-	QVector3D lightPos(0.f, 2800.f, 1500.f);
-
-	m_rotationCounter = (m_rotationCounter + 1) % 1800;
-	QQuaternion lightRot = QQuaternion::fromAxisAndAngle(QVector3D(0,1,0), -0.2*m_rotationCounter);
-//	QQuaternion lightRot = QQuaternion::fromAxisAndAngle(QVector3D(0,1,0), 5*m_rotationCounter/180. * 3.1415);
-	lightPos = lightRot.rotatedVector(lightPos);
-//	qDebug() << lightPos;
-//	renderLater();
 
 	m_gpuTimers.reset();
+	m_boxBatchTimers.reset();
 
 	// tell OpenGL to show only faces whose normal vector points towards us
 	glEnable(GL_CULL_FACE);
@@ -191,21 +266,30 @@ void SceneView::paintGL() {
 	// *** render boxes
 	m_gpuTimers.recordSample();
 
-	SHADER(2)->bind();
-	SHADER(2)->setUniformValue(m_shaderPrograms[2].m_uniformIDs[0], m_worldToView);
-	SHADER(2)->setUniformValue(m_shaderPrograms[2].m_uniformIDs[1], lightPos);
-	SHADER(2)->setUniformValue(m_shaderPrograms[2].m_uniformIDs[2], lightColor);
+	// shader programs #2, #6 and #7 have the same uniforms
+	int boxShader = boxShaderIndex();
+	SHADER(boxShader)->bind();
+	// set every frame, since renderLevelsOfDetail() leaves hoverBoxId at -1 after drawing the proxies
+	SHADER(boxShader)->setUniformValue(m_shaderPrograms[boxShader].m_uniformIDs[0], m_hoverBoxId);
+	SHADER(boxShader)->setUniformValue(m_shaderPrograms[boxShader].m_uniformIDs[1], m_hoverFaceId);
 
-	m_boxObject.render();
+	// chunks of boxes outside the view frustum (and hidden in a previous frame, with occlusion culling) are skipped
+	Frustum frustum(m_worldToView);
+	const DepthPyramid * occluders = (m_occlusionCulling && m_depthPyramid.isValid()) ? &m_depthPyramid : nullptr;
+	// with levels of detail, tiles of boxes further away from the camera are drawn with merged boxes
+	bool levelOfDetail = m_boxObject.m_levelOfDetail && m_boxObject.m_renderMode == BoxObject::RM_Vertexes;
+	if (levelOfDetail)
+		m_boxObject.renderLevelsOfDetail(m_camera.translation(), frustum, m_shaderPrograms[boxShader].m_uniformIDs[0], occluders);
+	else
+		m_boxObject.render(&m_boxBatchTimers, &frustum, occluders);
 
-	SHADER(2)->release();
+	SHADER(boxShader)->release();
 
 
 	// *** render lines
 	m_gpuTimers.recordSample();
 
 	SHADER(0)->bind();
-	SHADER(0)->setUniformValue(m_shaderPrograms[0].m_uniformIDs[0], m_worldToView);
 
 	if (m_pickLineObject.m_visible)
 		m_pickLineObject.render();
@@ -217,11 +301,10 @@ void SceneView::paintGL() {
 	m_gpuTimers.recordSample();
 
 	SHADER(1)->bind();
-	SHADER(1)->setUniformValue(m_shaderPrograms[1].m_uniformIDs[0], m_worldToView);
-	SHADER(1)->setUniformValue(m_shaderPrograms[1].m_uniformIDs[1], minorGridColor);
-	SHADER(1)->setUniformValue(m_shaderPrograms[1].m_uniformIDs[2], backColor);
+	SHADER(1)->setUniformValue(m_shaderPrograms[1].m_uniformIDs[0], minorGridColor);
+	SHADER(1)->setUniformValue(m_shaderPrograms[1].m_uniformIDs[1], backColor);
 	m_minorGridObject.render();
-	SHADER(1)->setUniformValue(m_shaderPrograms[1].m_uniformIDs[1], majorGridColor);
+	SHADER(1)->setUniformValue(m_shaderPrograms[1].m_uniformIDs[0], majorGridColor);
 	m_majorGridObject.render();
 	SHADER(1)->release();
 
@@ -235,7 +318,6 @@ void SceneView::paintGL() {
 	m_gpuTimers.recordSample(); // done painting
 
 	SHADER(3)->bind();
-	SHADER(3)->setUniformValue(m_shaderPrograms[3].m_uniformIDs[0], m_worldToView);
 
 	m_planeObject.render();
 
@@ -244,10 +326,15 @@ void SceneView::paintGL() {
 	// *** render text (always in front of all transparent stuff)
 
 	SHADER(4)->bind();
-	SHADER(4)->setUniformValue(m_shaderPrograms[4].m_uniformIDs[0], m_worldToView);
 	m_textObject.render();
 	SHADER(4)->release();
 
+	// occlusion culling: read back the depth buffer of this frame, to be used in the next frames
+	if (m_occlusionCulling) {
+		m_depthPyramid.capture(m_worldToView);
+		m_depthCaptureGeneration = m_boxObject.m_generation;
+	}
+
 	m_gpuTimers.recordSample(); // done painting
 
 
@@ -265,6 +352,47 @@ void SceneView::paintGL() {
 		qDebug() << "  " << it*1e-6 << "ms/frame";
 	QVector<GLuint64> samples = m_gpuTimers.waitForSamples();
 	qDebug() << "Total render time: " << (samples.back() - samples.front())*1e-6 << "ms/frame";
+	if (levelOfDetail) {
+		qDebug() << "  box tiles:" << m_boxObject.m_lodTiles[BoxLOD::L_Boxes] << "with boxes,"
+				 << m_boxObject.m_lodTiles[BoxLOD::L_Columns] << "with columns,"
+				 << m_boxObject.m_lodTiles[BoxLOD::L_Heightfield] << "with heightfield," << m_boxObject.m_lodCulledTiles << "culled;"
+				 << m_boxObject.m_lodTriangles << "of" << m_boxObject.m_boxes.size()*BoxMesh::IndexCount/3 << "box triangles drawn, boxes:"
+				 << intervals[0]*1e-6 << "ms/frame";
+	}
+	else if (m_boxObject.m_renderMode != BoxObject::RM_Instanced && m_boxObject.m_frustumCulling) {
+		if (occluders != nullptr) {
+			unsigned int frustumChunks = m_boxObject.m_drawnChunks + m_boxObject.m_occludedChunks;
+			qDebug() << "  box chunks:" << m_boxObject.m_drawnChunks << "drawn," << m_boxObject.m_culledChunks << "culled,"
+					 << m_boxObject.m_occludedChunks << "occluded ("
+					 << (frustumChunks > 0 ? 100.0*m_boxObject.m_occludedChunks/frustumChunks : 0.0) << "% of chunks in frustum), boxes:"
+					 << intervals[0]*1e-6 << "ms/frame";
+		}
+		else if (m_boxObject.m_gpuCulling && m_boxObject.m_gpuCuller.isCreated())
+			qDebug() << "  box chunks: culled on GPU," << m_boxObject.m_gpuCuller.commandCount() << "indirect draw commands";
+		else
+			qDebug() << "  box chunks:" << m_boxObject.m_drawnChunks << "drawn," << m_boxObject.m_culledChunks << "culled";
+	}
+	else if (m_boxObject.m_renderMode != BoxObject::RM_Instanced) {
+		unsigned int batchCount = qMin<unsigned int>(m_boxObject.m_elementBatches.batchCount(m_boxObject.m_boxes.size()),
+													  m_boxBatchTimers.sampleCount() - 1);
+		QVector<GLuint64> batchSamples = m_boxBatchTimers.waitForSamples();
+		for (unsigned int i=0; i<batchCount; ++i)
+			qDebug() << "  box batch" << i << ":" << (batchSamples[i+1] - batchSamples[i])*1e-6 << "ms/frame";
+	}
+	if (m_hoverPicking) {
+		qDebug() << "  hover pick: box" << m_hoverBoxId << "face" << m_hoverFaceId << "-" << m_hoverMovesSinceLastPick
+				 << "mouse moves coalesced; total:" << m_hoverMoveCount << "mouse moves," << m_hoverPickCount << "picks,"
+				 << m_hoverSkipCount << "skipped";
+		m_hoverMovesSinceLastPick = 0;
+	}
+
+	// boxes hidden in the frame the depth pyramid was built from may be visible now, so render again
+	// until the depth pyramid matches the current view and boxes
+	if (occluders != nullptr &&
+		(occluders->worldToView() != m_worldToView || m_depthPyramidGeneration != m_boxObject.m_generation))
+	{
+		renderLater();
+	}
 
 	qint64 elapsedMs = m_cpuTimer.elapsed();
 	qDebug() << "Total paintGL time: " << elapsedMs << "ms";
@@ -272,6 +400,71 @@ void SceneView::paintGL() {
 
 
 void SceneView::keyPressEvent(QKeyEvent *event) {
+	// P cycles through the pick algorithms, so that they can be compared
+	if (event->key() == Qt::Key_P && !event->isAutoRepeat()) {
+		m_boxObject.m_pickMethod = BoxObject::PickMethod((m_boxObject.m_pickMethod + 1) % BoxObject::NUM_PM);
+		qDebug() << "Pick method:" << m_boxObject.m_pickMethod;
+	}
+	// H toggles hover highlighting
+	if (event->key() == Qt::Key_H && !event->isAutoRepeat()) {
+		m_hoverPicking = !m_hoverPicking;
+		if (!m_hoverPicking) {
+			m_hoverBoxId = -1;
+			m_hoverFaceId = -1;
+			renderLater();
+		}
+		qDebug() << "Hover picking:" << m_hoverPicking;
+	}
+	// M toggles box animation
+	if (event->key() == Qt::Key_M && !event->isAutoRepeat()) {
+		m_animateBoxes = !m_animateBoxes;
+		renderLater();
+	}
+	// B cycles through the render modes of boxes (per-box vertexes, instanced, shared corners)
+	if (event->key() == Qt::Key_B && !event->isAutoRepeat()) {
+		toggleBoxRenderMode();
+		renderLater();
+	}
+	// T toggles between triangle lists and triangle strips for boxes
+	if (event->key() == Qt::Key_T && !event->isAutoRepeat()) {
+		toggleBoxTriangleStrips();
+		renderLater();
+	}
+	// V renders the boxes with per-box vertexes and with shared corners and compares images and frame times
+	if (event->key() == Qt::Key_V && !event->isAutoRepeat()) {
+		compareBoxRenderModes();
+		renderLater();
+	}
+	// C toggles frustum culling of box chunks
+	if (event->key() == Qt::Key_C && !event->isAutoRepeat()) {
+		m_boxObject.m_frustumCulling = !m_boxObject.m_frustumCulling;
+		qDebug() << "Frustum culling:" << m_boxObject.m_frustumCulling;
+		renderLater();
+	}
+	// G toggles between frustum culling on the GPU (if available) and on the CPU
+	if (event->key() == Qt::Key_G && !event->isAutoRepeat()) {
+		m_boxObject.m_gpuCulling = !m_boxObject.m_gpuCulling;
+		qDebug() << "GPU culling:" << m_boxObject.m_gpuCulling << (m_boxObject.m_gpuCuller.isCreated() ? "" : "(not available)");
+		renderLater();
+	}
+	// O toggles occlusion culling of box chunks with the depth buffer of the previous frame
+	if (event->key() == Qt::Key_O && !event->isAutoRepeat()) {
+		m_occlusionCulling = !m_occlusionCulling;
+		qDebug() << "Occlusion culling:" << m_occlusionCulling;
+		renderLater();
+	}
+	// L toggles levels of detail for boxes far away from the camera
+	if (event->key() == Qt::Key_L && !event->isAutoRepeat()) {
+		m_boxObject.m_levelOfDetail = !m_boxObject.m_levelOfDetail;
+		qDebug() << "Levels of detail:" << m_boxObject.m_levelOfDetail
+				 << (m_boxObject.m_renderMode == BoxObject::RM_Vertexes ? "" : "(vertex render mode only)");
+		renderLater();
+	}
+	// I toggles between ray casting and id buffer picking
+	if (event->key() == Qt::Key_I && !event->isAutoRepeat()) {
+		m_pickMode = (m_pickMode == PickRayCast) ? PickIdBuffer : PickRayCast;
+		qDebug() << "Pick mode:" << (m_pickMode == PickRayCast ? "ray cast" : "id buffer");
+	}
 	m_keyboardMouseHandler.keyPressEvent(event);
 	checkInput();
 }
@@ -291,7 +484,17 @@ void SceneView::mouseReleaseEvent(QMouseEvent *event) {
 	checkInput();
 }
 
-void SceneView::mouseMoveEvent(QMouseEvent * /*event*/) {
+void SceneView::mouseMoveEvent(QMouseEvent * event) {
+	// only remember the position, the pick is done once per frame in paintGL()
+	if (m_hoverPicking && !m_keyboardMouseHandler.buttonDown(Qt::RightButton)) {
+		m_hoverPos = event->pos();
+		++m_hoverMovesSinceLastPick;
+		++m_hoverMoveCount;
+		if (!m_hoverPending) {
+			m_hoverPending = true;
+			renderLater();
+		}
+	}
 	checkInput();
 }
 
@@ -304,6 +507,53 @@ void SceneView::wheelEvent(QWheelEvent *event) {
 void SceneView::pick(const QPoint & globalMousePos) {
 	// local mouse coordinates
 	QPoint localMousePos = mapFromGlobal(globalMousePos);
+
+	if (m_pickMode == PickIdBuffer) {
+		// just remember the pixel, the id pass is rendered in paintGL(); mind: OpenGL y-axis points upwards
+		const qreal retinaScale = devicePixelRatio(); // needed for Macs with retina display
+		m_pickPixel = QPoint(int(localMousePos.x()*retinaScale), int((height() - 1 - localMousePos.y())*retinaScale));
+		m_pickRequested = true;
+		m_pickTimer.start();
+		return;
+	}
+
+	// cached results are only valid for the same camera, view size and box geometry (compared with the
+	// same quantisation as the cache keys)
+	PickCacheKey key(m_worldToView, size(), devicePixelRatio(), localMousePos, m_boxObject.m_generation);
+	if (!key.sameView(m_pickCacheView)) {
+		m_pickCache.clear();
+		m_pickCacheView = key;
+	}
+
+	QVector3D nearPoint, farPoint;
+	if (!pickLine(localMousePos, nearPoint, farPoint))
+		return;
+
+	// update pick line vertices (visualize pick line)
+	m_context->makeCurrent(this);
+	m_pickLineObject.setPoints(nearPoint, farPoint);
+
+	// same pixel clicked before?
+	QHash<PickCacheKey, PickObject>::const_iterator it = m_pickCache.constFind(key);
+	if (it != m_pickCache.constEnd()) {
+		++m_pickCacheHits;
+		qDebug() << "Pick result taken from cache (" << m_pickCacheHits << "hits," << m_pickCacheMisses << "misses )";
+		highlightPickedObject(it.value());
+		return;
+	}
+	++m_pickCacheMisses;
+
+	// now do the actual picking - for now we implement a selection
+	PickObject p = selectNearestObject(nearPoint, farPoint);
+
+	// keep the cache small, a camera move invalidates all entries anyway
+	if (m_pickCache.size() >= 256)
+		m_pickCache.clear();
+	m_pickCache.insert(key, p);
+}
+
+
+bool SceneView::pickLine(const QPoint & localMousePos, QVector3D & nearPoint, QVector3D & farPoint) const {
 	int my = localMousePos.y();
 	int mx = localMousePos.x();
 
@@ -317,7 +567,7 @@ void SceneView::pick(const QPoint & globalMousePos) {
 	QMatrix4x4 projectionMatrixInverted = m_worldToView.inverted(&invertible);
 	if (!invertible) {
 		qWarning()<< "Cannot invert projection matrix.";
-		return;
+		return false;
 	}
 
 	// mouse position in NDC space, one point on near plane and one point on far plane
@@ -340,12 +590,31 @@ void SceneView::pick(const QPoint & globalMousePos) {
 	nearResult /= nearResult.w();
 	farResult /= farResult.w();
 
-	// update pick line vertices (visualize pick line)
-	m_context->makeCurrent(this);
-	m_pickLineObject.setPoints(nearResult.toVector3D(), farResult.toVector3D());
+	nearPoint = nearResult.toVector3D();
+	farPoint = farResult.toVector3D();
+	return true;
+}
 
-	// now do the actual picking - for now we implement a selection
-	selectNearestObject(nearResult.toVector3D(), farResult.toVector3D());
+
+std::vector<unsigned int> SceneView::selectBoxesInRect(const QRect & rect) {
+	QElapsedTimer selectTimer;
+	selectTimer.start();
+
+	// rectangle in normalized device coordinates, mind: y-axis points upwards in NDC
+	float left = 2.f*rect.left()/width() - 1;
+	float right = 2.f*(rect.right() + 1)/width() - 1;
+	float top = 1 - 2.f*rect.top()/height();
+	float bottom = 1 - 2.f*(rect.bottom() + 1)/height();
+
+	// the part of the view frustum seen through the rectangle
+	Frustum frustum = Frustum::fromNDCRect(m_worldToView, left, bottom, right, top);
+
+	std::vector<unsigned int> boxIds;
+	boxesInFrustum(m_boxObject.m_boxBounds, frustum, boxIds);
+	qDebug() << "Selected" << boxIds.size() << "boxes in" << selectTimer.nsecsElapsed()*1e-6 << "ms";
+
+	m_boxObject.highlight(boxIds);
+	return boxIds;
 }
 
 
@@ -438,7 +707,15 @@ void SceneView::processInput() {
 
 	// check for picking operation
 	if (m_keyboardMouseHandler.buttonReleased(Qt::LeftButton)) {
-		pick(m_keyboardMouseHandler.mouseReleasePos());
+		// mouse moved while left button was held? Then select all boxes in the dragged rectangle
+		QPoint dragDistance = m_keyboardMouseHandler.mouseReleasePos() - m_keyboardMouseHandler.mouseDownPos();
+		if (dragDistance.manhattanLength() > 4) {
+			QRect rect(mapFromGlobal(m_keyboardMouseHandler.mouseDownPos()),
+					   mapFromGlobal(m_keyboardMouseHandler.mouseReleasePos()));
+			selectBoxesInRect(rect.normalized());
+		}
+		else
+			pick(m_keyboardMouseHandler.mouseReleasePos());
 	}
 
 	// finally, reset "WasPressed" key states
@@ -458,7 +735,7 @@ void SceneView::updateWorld2ViewMatrix() {
 }
 
 
-void SceneView::selectNearestObject(const QVector3D & nearPoint, const QVector3D & farPoint) {
+PickObject SceneView::selectNearestObject(const QVector3D & nearPoint, const QVector3D & farPoint) {
 	QElapsedTimer pickTimer;
 	pickTimer.start();
 
@@ -469,17 +746,297 @@ void SceneView::selectNearestObject(const QVector3D & nearPoint, const QVector3D
 	PickObject p(2.f, std::numeric_limits<unsigned int>::max());
 
 	// now process all objects and update p to hold the closest hit
+	QElapsedTimer boxPickTimer;
+	boxPickTimer.start();
 	m_boxObject.pick(nearPoint, d, p);
+	qDebug() << "BoxObject::pick() time:" << boxPickTimer.nsecsElapsed()*1e-6 << "ms";
 	// ... other objects
 
 	// any object accepted a pick?
 	if (p.m_objectId == std::numeric_limits<unsigned int>::max())
-		return; // nothing selected
+		return p; // nothing selected
 
 	qDebug().nospace() << "Pick successful (Box #"
 					   << p.m_objectId <<  ", Face #" << p.m_faceId << ", t = " << p.m_dist << ") after "
 					   << pickTimer.elapsed() << " ms";
 
+	highlightPickedObject(p);
+	return p;
+}
+
+
+void SceneView::highlightPickedObject(const PickObject & p) {
+	if (p.m_objectId == std::numeric_limits<unsigned int>::max())
+		return; // nothing selected
+
 	// Mind: OpenGL-context must be current when we call this function!
 	m_boxObject.highlight(p.m_objectId, p.m_faceId);
 }
+
+
+void SceneView::renderPickIds() {
+	m_pickRequested = false;
+
+	m_pickFramebuffer.bind();
+
+	// ids must not be blended, and all opaque and transparent objects are written into the depth buffer
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+
+	SHADER(5)->bind();
+
+	// boxes, 6 faces with 4 vertexes each per box, 8 shared corners per box, or one instance per box
+	glEnable(GL_CULL_FACE);
+	SHADER(5)->setUniformValue(m_shaderPrograms[5].m_uniformIDs[0], (GLuint)PO_Box);
+	SHADER(5)->setUniformValue(m_shaderPrograms[5].m_uniformIDs[1], (GLint)m_boxObject.m_elementBatches.m_verticesPerObject);
+	SHADER(5)->setUniformValue(m_shaderPrograms[5].m_uniformIDs[2], (GLint)(m_boxObject.m_renderMode == BoxObject::RM_Instanced));
+	Frustum frustum(m_worldToView);
+	m_boxObject.render(nullptr, &frustum);
+	SHADER(5)->setUniformValue(m_shaderPrograms[5].m_uniformIDs[2], (GLint)false);
+
+	// planes and texts are visible from both sides, and have 4 vertexes each
+	glDisable(GL_CULL_FACE);
+	SHADER(5)->setUniformValue(m_shaderPrograms[5].m_uniformIDs[0], (GLuint)PO_Plane);
+	SHADER(5)->setUniformValue(m_shaderPrograms[5].m_uniformIDs[1], 4);
+	m_planeObject.render();
+
+	SHADER(5)->setUniformValue(m_shaderPrograms[5].m_uniformIDs[0], (GLuint)PO_Text);
+	m_textObject.render();
+
+	SHADER(5)->release();
+
+	m_pickFramebuffer.readPixel(m_pickPixel.x(), m_pickPixel.y());
+	m_pickFramebuffer.release();
+}
+
+
+void SceneView::processPickResult() {
+	unsigned int objectType, objectId, faceId;
+	if (!m_pickFramebuffer.fetchResult(objectType, objectId, faceId)) {
+		// GPU not yet done, check again with next frame
+		renderLater();
+		return;
+	}
+
+	switch (objectType) {
+		case PO_Box :
+			qDebug().nospace() << "Pick successful (Box #" << objectId << ", Face #" << faceId << ") after "
+							   << m_pickTimer.nsecsElapsed()*1e-6 << " ms";
+			// Mind: OpenGL-context is current, since we are called from paintGL()
+			m_boxObject.highlight(objectId, faceId);
+		break;
+
+		case PO_Plane :
+			qDebug().nospace() << "Pick successful (Plane #" << objectId << ") after "
+							   << m_pickTimer.nsecsElapsed()*1e-6 << " ms";
+		break;
+
+		case PO_Text :
+			qDebug().nospace() << "Pick successful (Text #" << objectId << ") after "
+							   << m_pickTimer.nsecsElapsed()*1e-6 << " ms";
+		break;
+
+		default : ; // background, nothing selected
+	}
+}
+
+
+void SceneView::hoverPick() {
+	m_hoverPending = false;
+
+	// neither mouse nor camera moved and no box was modified since last pick? Then the result is still valid.
+	if (m_hoverPos == m_lastHoverPos && m_worldToView == m_lastHoverWorldToView &&
+		m_boxObject.m_generation == m_lastHoverGeneration)
+	{
+		++m_hoverSkipCount;
+		return;
+	}
+	m_lastHoverPos = m_hoverPos;
+	m_lastHoverWorldToView = m_worldToView;
+	m_lastHoverGeneration = m_boxObject.m_generation;
+
+	QVector3D nearPoint, farPoint;
+	if (!pickLine(m_hoverPos, nearPoint, farPoint))
+		return;
+
+	// uses the same acceleration structures as the regular pick
+	PickObject p(2.f, std::numeric_limits<unsigned int>::max());
+	m_boxObject.pick(nearPoint, farPoint - nearPoint, p);
+	if (p.m_objectId == std::numeric_limits<unsigned int>::max()) {
+		m_hoverBoxId = -1;
+		m_hoverFaceId = -1;
+	}
+	else {
+		m_hoverBoxId = (int)p.m_objectId;
+		m_hoverFaceId = (int)p.m_faceId;
+	}
+
+	++m_hoverPickCount;
+}
+
+
+void SceneView::importBoxes(const QString & fileName) {
+	if (!m_boxImporter.start(fileName))
+		return;
+	qDebug() << "Importing boxes from" << fileName << "(" << m_boxImporter.fileSize()/(1024.0*1024) << "MByte)";
+	m_importTimer.start();
+	renderLater();
+}
+
+
+void SceneView::takeImportedBoxes() {
+	BoxStore boxes;
+	m_boxImporter.takeBoxes(boxes);
+	if (boxes.size() != 0)
+		m_boxObject.appendBoxes(boxes);
+
+	double secs = m_importTimer.elapsed()*1e-3;
+	if (m_boxImporter.isRunning()) {
+		qDebug() << "Importing boxes:" << m_boxImporter.bytesTaken()*100.0/m_boxImporter.fileSize() << "% done,"
+				 << m_boxObject.m_boxes.size() << "boxes";
+		// keep on rendering until all boxes are imported
+		renderLater();
+	}
+	else
+		qDebug() << "Import finished:" << m_boxObject.m_boxes.size() << "boxes in" << secs << "s ("
+				 << m_boxImporter.fileSize()/(1024.0*1024)/qMax(secs, 1e-3) << "MByte/s)";
+}
+
+
+void SceneView::animateBoxes() {
+	QElapsedTimer t;
+	t.start();
+	// skip the first 4 boxes (coordinate axes and labeled box)
+	const unsigned int FirstBox = 4;
+	for (unsigned int i=0; i<20 && m_boxObject.m_boxes.size() > FirstBox; ++i) {
+		unsigned int boxId = FirstBox + qrand() % (m_boxObject.m_boxes.size() - FirstBox);
+		QMatrix4x4 trans;
+		trans.translate(0.1f*(qrand() % 11 - 5), 0, 0.1f*(qrand() % 11 - 5));
+		m_boxObject.transformBox(boxId, trans);
+	}
+	qDebug() << "Moved boxes in" << t.nsecsElapsed()*1e-6 << "ms, BVH degradation" << m_boxObject.m_bvh.degradation();
+}
+
+
+void SceneView::toggleBoxRenderMode() {
+	m_context->makeCurrent(this);
+	// buffers are recreated with the layout of the new render mode
+	m_boxObject.destroy();
+	m_boxObject.m_renderMode = BoxObject::RenderMode((m_boxObject.m_renderMode + 1) % BoxObject::NUM_RM);
+	QElapsedTimer t;
+	t.start();
+	m_boxObject.create(SHADER(boxShaderIndex()));
+	qDebug() << "Box render mode:" << boxRenderModeName(m_boxObject.m_renderMode)
+			 << ", buffers uploaded in" << t.nsecsElapsed()*1e-6 << "ms";
+}
+
+
+const char * SceneView::boxRenderModeName(BoxObject::RenderMode renderMode) {
+	switch (renderMode) {
+		case BoxObject::RM_Vertexes			: return "vertexes";
+		case BoxObject::RM_Instanced		: return "instanced";
+		case BoxObject::RM_SharedCorners	: return "shared corners";
+		case BoxObject::NUM_RM				: ;
+	}
+	return "";
+}
+
+
+void SceneView::compareBoxRenderModes() {
+	m_context->makeCurrent(this);
+	const BoxObject::RenderMode renderMode = m_boxObject.m_renderMode;
+
+	// only the box pass is rendered, into an offscreen framebuffer of the window size; the id pass, animation,
+	// box import, hover picking, occlusion culling and levels of detail of paintGL() are not run, so that
+	// both images show the same boxes and the timings contain the box pass only
+	const qreal retinaScale = devicePixelRatio(); // needed for Macs with retina display
+	const int w = int(width()*retinaScale);
+	const int h = int(height()*retinaScale);
+	GLuint fbo, colorBuffer, depthBuffer;
+	glGenFramebuffers(1, &fbo);
+	glGenRenderbuffers(1, &colorBuffer);
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, w, h);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		qWarning() << "SceneView - Offscreen framebuffer for comparing box render modes is incomplete";
+	glViewport(0, 0, w, h);
+
+	// fixed light (the light is rotated in paintGL())
+	m_frameUniforms.update(m_worldToView, m_camera.translation(), QVector3D(0.f, 2800.f, 1500.f), QVector3D(1.f, 1.f, 1.f));
+	Frustum frustum(m_worldToView);
+
+	const BoxObject::RenderMode modes[2] = { BoxObject::RM_Vertexes, BoxObject::RM_SharedCorners };
+	const int FrameCount = 10;
+	std::vector<unsigned char> images[2];
+	for (int m=0; m<2; ++m) {
+		m_boxObject.destroy();
+		m_boxObject.m_renderMode = modes[m];
+		m_boxObject.create(SHADER(boxShaderIndex()));
+
+		// GPU time of the box pass, the first frame is not counted
+		double boxMs = 0;
+		for (int i=0; i<=FrameCount; ++i) {
+			glDepthMask(GL_TRUE);
+			glClearColor(0.1f, 0.15f, 0.3f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			glEnable(GL_CULL_FACE);
+
+			m_gpuTimers.reset();
+			m_gpuTimers.recordSample();
+			int boxShader = boxShaderIndex();
+			SHADER(boxShader)->bind();
+			// no hover highlighting
+			SHADER(boxShader)->setUniformValue(m_shaderPrograms[boxShader].m_uniformIDs[0], -1);
+			SHADER(boxShader)->setUniformValue(m_shaderPrograms[boxShader].m_uniformIDs[1], -1);
+			m_boxObject.render(nullptr, &frustum, nullptr);
+			SHADER(boxShader)->release();
+			m_gpuTimers.recordSample();
+
+			glDisable(GL_CULL_FACE);
+			if (i > 0)
+				boxMs += m_gpuTimers.waitForIntervals()[0]*1e-6/FrameCount;
+		}
+		images[m].resize(w*h*4);
+		glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, images[m].data());
+		qDebug() << "Box render mode" << boxRenderModeName(modes[m]) << ":" << boxMs << "ms/frame (box pass only),"
+				 << m_boxObject.m_drawnChunks << "chunks drawn";
+	}
+
+	unsigned int differentPixels = 0;
+	int maxDiff = 0;
+	for (unsigned int p=0; p<images[0].size(); p += 4) {
+		int diff = 0;
+		for (unsigned int j=0; j<3; ++j)
+			diff = qMax(diff, qAbs(int(images[1][p+j]) - int(images[0][p+j])));
+		if (diff > 0)
+			++differentPixels;
+		maxDiff = qMax(maxDiff, diff);
+	}
+	qDebug() << "Box render mode" << boxRenderModeName(modes[1]) << ":" << differentPixels << "of" << w*h
+			 << "pixels differ from" << boxRenderModeName(modes[0]) << "image, max. color difference" << maxDiff;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_context->defaultFramebufferObject());
+	glDeleteRenderbuffers(1, &depthBuffer);
+	glDeleteRenderbuffers(1, &colorBuffer);
+	glDeleteFramebuffers(1, &fbo);
+
+	m_boxObject.destroy();
+	m_boxObject.m_renderMode = renderMode;
+	m_boxObject.create(SHADER(boxShaderIndex()));
+}
+
+
+void SceneView::toggleBoxTriangleStrips() {
+	m_context->makeCurrent(this);
+	m_boxObject.destroy();
+	m_boxObject.m_triangleStrips = !m_boxObject.m_triangleStrips;
+	m_boxObject.create(SHADER(boxShaderIndex()));
+	qDebug() << "Box faces drawn as:" << (m_boxObject.m_triangleStrips ? "triangle strips" : "triangles");
+}
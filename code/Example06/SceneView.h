@@ -21,10 +21,15 @@ License    : BSD License,
 #include "KeyboardMouseHandler.h"
 #include "GridObject.h"
 #include "BoxObject.h"
+#include "BoxImporter.h"
+#include "DepthPyramid.h"
+#include "FrameUniformBuffer.h"
 #include "PickLineObject.h"
 #include "Camera.h"
 #include "PlaneObject.h"
 #include "TextObject.h"
+#include "PickFramebuffer.h"
+#include "PickObject.h"
 
 /*! The class SceneView extends the primitive OpenGLWindow
 	by adding keyboard/mouse event handling, and rendering of different
@@ -32,6 +37,14 @@ License    : BSD License,
 */
 class SceneView : public OpenGLWindow {
 public:
+	/*! Different ways to determine the object under the mouse cursor. */
+	enum PickMode {
+		/*! Intersect pick line with object geometry on the CPU (see selectNearestObject()). */
+		PickRayCast,
+		/*! Render object and face ids into an offscreen buffer and read back the pixel under the cursor. */
+		PickIdBuffer
+	};
+
 	SceneView();
 	virtual ~SceneView() override;
 
@@ -50,6 +63,18 @@ protected:
 
 	void pick(const QPoint & globalMousePos);
 
+	/*! Computes the pick line through the mouse position (local window coordinates), given by the
+		points on the near and far plane in model coordinates. Returns false, if the world to view matrix
+		cannot be inverted.
+	*/
+	bool pickLine(const QPoint & localMousePos, QVector3D & nearPoint, QVector3D & farPoint) const;
+
+	/*! Selects all boxes within the rectangle (in local window coordinates) and highlights them.
+		Returns the indexes of the selected boxes.
+		Mind: OpenGL-context must be current when we call this function!
+	*/
+	std::vector<unsigned int> selectBoxesInRect(const QRect & rect);
+
 private:
 	/*! Tests, if any relevant input was received and registers a state change. */
 	void checkInput();
@@ -64,8 +89,61 @@ private:
 
 	/*! Determine which objects/planes are selected and color them accordingly.
 		nearPoint and farPoint define the current ray and are given in model coordinates.
+		Returns the pick result.
+	*/
+	PickObject selectNearestObject(const QVector3D & nearPoint, const QVector3D & farPoint);
+
+	/*! Colors the object of a pick result as selected. */
+	void highlightPickedObject(const PickObject & p);
+
+	/*! Renders object and face ids of all pickable objects into m_pickFramebuffer and
+		starts the read back of the pixel at m_pickPixel.
+	*/
+	void renderPickIds();
+
+	/*! Evaluates the ids read back from m_pickFramebuffer, once available. */
+	void processPickResult();
+
+	/*! Picks the box under the mouse cursor for hover highlighting, called once per frame at the
+		begin of paintGL() if the mouse was moved.
 	*/
-	void selectNearestObject(const QVector3D & nearPoint, const QVector3D & farPoint);
+	void hoverPick();
+
+	/*! Starts importing boxes from a file (see BoxImporter), the boxes are added to the box object
+		while the file is parsed.
+	*/
+	void importBoxes(const QString & fileName);
+	/*! Appends the boxes imported since the last call to the box object, called once per frame
+		while the import is running.
+		Mind: OpenGL-context must be current when we call this function!
+	*/
+	void takeImportedBoxes();
+
+	/*! Moves a few randomly selected boxes, to demonstrate incremental updates of the picking structures. */
+	void animateBoxes();
+
+	/*! Switches the box object to the next render mode (per-box vertexes, instanced, shared corners),
+		recreates the buffers.
+	*/
+	void toggleBoxRenderMode();
+	/*! Renders only the boxes (with fixed light, without occlusion culling and levels of detail) into an
+		offscreen framebuffer, with per-box vertexes and with shared corners. Reports the GPU time of the
+		box pass and the number of pixels that differ between both images.
+	*/
+	void compareBoxRenderModes();
+	/*! Name of the box render mode for messages. */
+	static const char * boxRenderModeName(BoxObject::RenderMode renderMode);
+	/*! Switches the box object between triangle lists and triangle strips, recreates the buffers. */
+	void toggleBoxTriangleStrips();
+
+	/*! Index of the shader program matching the render mode of the box object. */
+	int boxShaderIndex() const {
+		switch (m_boxObject.m_renderMode) {
+			case BoxObject::RM_Instanced		: return 6;
+			case BoxObject::RM_SharedCorners	: return 7;
+			default								: return 2;
+		}
+	}
 
 	/*! If set to true, an input event was received, which will be evaluated at next repaint. */
 	bool						m_inputEventReceived;
@@ -81,6 +159,8 @@ private:
 
 	/*! All shader programs used in the scene. */
 	QList<ShaderProgram>		m_shaderPrograms;
+	/*! Camera and light data shared by all shader programs, updated once per frame in paintGL(). */
+	FrameUniformBuffer			m_frameUniforms;
 
 	BoxObject					m_boxObject;
 	GridObject					m_minorGridObject;
@@ -90,9 +170,69 @@ private:
 	TextObject					m_textObject;
 
 	QOpenGLTimeMonitor			m_gpuTimers;
+	/*! GPU time stamps before and after each box draw batch (vertex render mode). */
+	QOpenGLTimeMonitor			m_boxBatchTimers;
 	QElapsedTimer				m_cpuTimer;
 
 	int							m_rotationCounter = 0;
+
+	/*! Currently used pick mode, toggled with key I. */
+	PickMode					m_pickMode = PickRayCast;
+	/*! Offscreen framebuffer with object ids, used in PickIdBuffer mode. */
+	PickFramebuffer				m_pickFramebuffer;
+	/*! If true, the id pass is rendered in the next paintGL() call. */
+	bool						m_pickRequested = false;
+	/*! Pixel to pick (framebuffer coordinates, y = 0 is the bottom row). */
+	QPoint						m_pickPixel;
+	/*! Measures time between pick request and evaluation of pick result in PickIdBuffer mode. */
+	QElapsedTimer				m_pickTimer;
+
+	/*! Pick results of previous clicks (ray cast mode). Cleared whenever camera, view size or box geometry changes. */
+	QHash<PickCacheKey, PickObject>	m_pickCache;
+	/*! Key of the last pick, holds camera, view size and box geometry generation of the cached pick results. */
+	PickCacheKey				m_pickCacheView;
+	/*! Statistics: cache hits and misses. */
+	unsigned int				m_pickCacheHits = 0;
+	unsigned int				m_pickCacheMisses = 0;
+
+	/*! If true, the box under the mouse cursor is highlighted (toggled with key H). */
+	bool						m_hoverPicking = false;
+	/*! Set in mouseMoveEvent(), cleared in hoverPick(). */
+	bool						m_hoverPending = false;
+	/*! Mouse position (local window coordinates) of the last mouse move event. */
+	QPoint						m_hoverPos;
+	/*! Mouse position, world to view matrix and box generation used in the last hover pick, to skip picks
+		if nothing changed.
+	*/
+	QPoint						m_lastHoverPos;
+	QMatrix4x4					m_lastHoverWorldToView;
+	unsigned int				m_lastHoverGeneration = 0;
+	/*! Box and face under the mouse cursor, -1 if none. Passed to the box shader. */
+	int							m_hoverBoxId = -1;
+	int							m_hoverFaceId = -1;
+	/*! Statistics: mouse moves since last frame, total mouse moves, hover picks done and skipped.
+		Reported with the frame statistics in paintGL().
+	*/
+	unsigned int				m_hoverMovesSinceLastPick = 0;
+	unsigned int				m_hoverMoveCount = 0;
+	unsigned int				m_hoverPickCount = 0;
+	unsigned int				m_hoverSkipCount = 0;
+
+	/*! Imports boxes from the file given on the command line. */
+	BoxImporter					m_boxImporter;
+	/*! Measures the import time. */
+	QElapsedTimer				m_importTimer;
+
+	/*! If true, chunks of boxes hidden behind the depth buffer of a previous frame are skipped (toggled with key O). */
+	bool						m_occlusionCulling = false;
+	/*! Depth pyramid built from the depth buffer of a previous frame, used for occlusion culling. */
+	DepthPyramid				m_depthPyramid;
+	/*! Box geometry generation of the depth buffer being read back and of the depth pyramid. */
+	unsigned int				m_depthCaptureGeneration = 0;
+	unsigned int				m_depthPyramidGeneration = 0;
+
+	/*! If true, some boxes are moved in each frame (toggled with key M). */
+	bool						m_animateBoxes = false;
 };
 
 #endif // SCENEVIEW_H
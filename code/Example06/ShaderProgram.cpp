@@ -12,9 +12,28 @@ License    : BSD License,
 #include "ShaderProgram.h"
 
 #include <QOpenGLShaderProgram>
+#include <QFile>
 #include <QDebug>
 
 #include "OpenGLException.h"
+#include "FrameUniformBuffer.h"
+
+/*! Reads the shader code from file and inserts the declaration of the uniform block shared by all
+	shader programs (see FrameUniformBuffer) after the #version line. Returns false if a file cannot be read.
+*/
+static bool readShaderSource(const QString & filePath, QByteArray & source) {
+	QFile shaderFile(filePath);
+	QFile blockFile(FrameUniformBuffer::BlockSourceFile);
+	if (!shaderFile.open(QIODevice::ReadOnly | QIODevice::Text) || !blockFile.open(QIODevice::ReadOnly | QIODevice::Text))
+		return false;
+	source = shaderFile.readAll();
+	// #version must remain the first statement; "#line 2" keeps the line numbers in compiler errors
+	// matching the lines of the shader file
+	int pos = source.indexOf('\n') + 1;
+	source.insert(pos, blockFile.readAll() + "#line 2\n");
+	return true;
+}
+
 
 ShaderProgram::ShaderProgram(const QString & vertexShaderFilePath, const QString & fragmentShaderFilePath) :
 	m_vertexShaderFilePath(vertexShaderFilePath),
@@ -34,15 +53,24 @@ void ShaderProgram::create() {
 	m_program = new QOpenGLShaderProgram();
 
 	// read the shader programs from the resource
-	if (!m_program->addShaderFromSourceFile(QOpenGLShader::Vertex, m_vertexShaderFilePath))
+	QByteArray vertexShaderSource, fragmentShaderSource;
+	if (!readShaderSource(m_vertexShaderFilePath, vertexShaderSource))
+		throw OpenGLException(QString("Error reading vertex shader %1").arg(m_vertexShaderFilePath), FUNC_ID);
+	if (!readShaderSource(m_fragmentShaderFilePath, fragmentShaderSource))
+		throw OpenGLException(QString("Error reading fragment shader %1").arg(m_fragmentShaderFilePath), FUNC_ID);
+
+	if (!m_program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource))
 		throw OpenGLException(QString("Error compiling vertex shader %1:\n%2").arg(m_vertexShaderFilePath).arg(m_program->log()), FUNC_ID);
 
-	if (!m_program->addShaderFromSourceFile(QOpenGLShader::Fragment, m_fragmentShaderFilePath))
+	if (!m_program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderSource))
 		throw OpenGLException(QString("Error compiling fragment shader %1:\n%2").arg(m_fragmentShaderFilePath).arg(m_program->log()), FUNC_ID);
 
 	if (!m_program->link())
 		throw OpenGLException(QString("Shader linker error:\n%2").arg(m_program->log()), FUNC_ID);
 
+	// camera and light data are read from the shared per-frame uniform buffer
+	FrameUniformBuffer::bindUniformBlock(m_program);
+
 	m_uniformIDs.clear();
 	for (const QString & uniformName : m_uniformNames)
 		m_uniformIDs.append( m_program->uniformLocation(uniformName));
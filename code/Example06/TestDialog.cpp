@@ -62,7 +62,10 @@ TestDialog::TestDialog() :
 	navigationInfo->setWordWrap(true);
 	navigationInfo->setText("Hold right mouse button for free mouse look and to navigate "
 							"with keys WASDQE. Hold shift to slow down. Use scroll-wheel to move quickly forward and backward. "
-							"Use left-click to select objects.");
+							"Use left-click to select objects, drag with left mouse button to select all boxes within a rectangle. "
+							"H toggles hover highlighting, M moves boxes around, P cycles through the pick algorithms, I toggles between ray casting and id buffer picking, "
+							"B cycles through the box render modes (vertexes, instanced, shared corners), V compares vertexes and shared corners, T toggles triangle strips, C toggles frustum culling, G culling on the GPU (OpenGL 4.3), O occlusion culling and L levels of detail. "
+							"Pass a .csv, .json or .obj file as command line argument to import boxes from it.");
 	hlay->addWidget(navigationInfo);
 
 	QPushButton * closeBtn = new QPushButton(tr("Close"), this);
@@ -97,10 +97,10 @@ void TextObject::create(ShaderProgram & shaderProgram) {
 	qDebug()<< "Texture mipmap levels: " << m_texture->mipLevels();
 	// tell shader to associate texture uniform 'text01' with a texture index
 	// Basically, this means that the texture uniform named 'text01' in the fragmentation shader,
-	// whose uniformIndex was stored in location m_shaderPrograms[0].m_uniformIDs[1], will
+	// whose uniformIndex was stored in location m_shaderPrograms[4].m_uniformIDs[0], will
 	// now be associated with an OpenGL texture bound to index TEXTURE_ID (=0 here)
 	// later we bind our texted with index 0
-	shaderProgram.shaderProgram()->setUniformValue(shaderProgram.m_uniformIDs[1], TEXTURE_ID);
+	shaderProgram.shaderProgram()->setUniformValue(shaderProgram.m_uniformIDs[0], TEXTURE_ID);
 
 	// resize storage arrays
 	m_vertexBufferData.resize(m_texts.size()*PlaneMesh::VertexCount);
@@ -74,6 +74,66 @@ struct VertexVNC {
 	float r,g,b;
 };
 
+/*! Packed variant of VertexVNC, for large meshes where memory and bandwidth matter.
+
+	Memory layout (each char is a byte): xxxxyyyyzzzznnnnrgba = 3*4 + 4 + 4 = 20 Bytes
+
+	The normal vector is packed into a single 32-bit integer as 3 signed 10-bit components
+	(format GL_INT_2_10_10_10_REV, x in the lowest bits, the 2 highest bits are unused). Colors are stored
+	with one byte per component (GL_UNSIGNED_BYTE). Both are passed as normalized attributes,
+	so the shader sees the same vec3 values as with VertexVNC (normals with a precision of about 1/511).
+*/
+struct VertexPNC {
+	VertexPNC() {}
+	VertexPNC(const QVector3D & coords, const QVector3D & normal, const QColor & col) :
+		x(float(coords.x())),
+		y(float(coords.y())),
+		z(float(coords.z())),
+		n(packNormal(normal)),
+		r((unsigned char)col.red()),
+		g((unsigned char)col.green()),
+		b((unsigned char)col.blue()),
+		a((unsigned char)col.alpha())
+	{
+	}
+
+	/*! Packs the components of a normal vector (each in the range -1..1) into 10-bit signed integers. */
+	static quint32 packNormal(const QVector3D & normal) {
+		quint32 packed = 0;
+		for (int i=0; i<3; ++i) {
+			int c = qRound(qBound(-1.f, normal[i], 1.f)*511);
+			packed |= (quint32(c) & 0x3FF) << (10*i);
+		}
+		return packed;
+	}
+
+	float x,y,z;
+	quint32 n;
+	unsigned char r,g,b,a;
+};
+
+
+/*! Vertex with coordinates and color only, for meshes where normals are computed in the shader.
+
+	Memory layout (each char is a byte): xxxxyyyyzzzzrgba = 3*4 + 4 = 16 Bytes
+*/
+struct VertexPC {
+	VertexPC() {}
+	VertexPC(const QVector3D & coords, const QColor & col) :
+		x(float(coords.x())),
+		y(float(coords.y())),
+		z(float(coords.z())),
+		r((unsigned char)col.red()),
+		g((unsigned char)col.green()),
+		b((unsigned char)col.blue()),
+		a((unsigned char)col.alpha())
+	{
+	}
+
+	float x,y,z;
+	unsigned char r,g,b,a;
+};
+
 
 /*! A container class to store data (coordinates, normals, textures, colors) of a vertex, used for interleaved
 	storage. Expand this class as needed.
@@ -119,4 +179,19 @@ struct VertexTex {
 };
 
 
+/*! Per-instance data of a box, used for instanced rendering, where all boxes share a single unit cube
+	mesh that is scaled and moved into place by the vertex shader.
+
+	Memory layout (each char is a byte): xxxxyyyyzzzzuuuuvvvvwwww + 6 * rgba = 6*4 + 6*4 = 48 Bytes
+
+	(xyz = translation, i.e. box center; uvw = scale factors, i.e. box dimensions;
+	 face colors with one byte per component, alpha is unused)
+*/
+struct BoxInstance {
+	float x,y,z;
+	float sx,sy,sz;
+	unsigned char colors[6][4];
+};
+
+
 #endif // VERTEX_H
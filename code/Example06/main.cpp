@@ -19,6 +19,7 @@ License    : BSD License,
 
 #include "OpenGLException.h"
 #include "DebugApplication.h"
+#include "Benchmarks.h"
 
 void qDebugMsgHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg) {
 	(void) context;
@@ -41,6 +42,10 @@ int main(int argc, char **argv) {
 
 	DebugApplication app(argc, argv);
 
+#ifdef RUN_BENCHMARKS
+	return runBenchmarks();
+#endif // RUN_BENCHMARKS
+
 	qsrand(time(nullptr));
 
 	TestDialog dlg;
@@ -0,0 +1,9 @@
+// Per-frame data shared by all shader programs, written by FrameUniformBuffer::update().
+// Mind: this declaration is inserted after the #version line of every shader by ShaderProgram::create(),
+//       the members must match FrameUniformBuffer::FrameData (std140 layout)
+layout(std140) uniform FrameData {
+  mat4 worldToView;                    // world to view transformation matrix (projection * camera)
+  vec3 cameraPos;                      // camera position (world coords)
+  vec3 lightPos;                       // light position (world coords)
+  vec3 lightColor;                     // light color as rgb
+};
@@ -0,0 +1,27 @@
+#version 330
+
+// GLSL version 3.3
+// vertex shader for boxes stored with 8 shared corners: the face color is passed as 'flat' output, so that each
+// triangle takes the color of its last (provoking) vertex; normals are computed in the fragment shader (diffuseFlat.frag)
+
+layout(location = 0) in vec3 position; // input:  attribute with index '0' with 3 elements per vertex
+layout(location = 2) in vec3 color;    // input:  attribute with index '2' with 3 elements (=rgb) per vertex
+flat out vec3 fragColor;               // output: face color, not interpolated
+out vec3 fragPos;                      // output: fragment position in world coords
+
+// uniform block FrameData (worldToView, cameraPos, lightPos, lightColor) is inserted by ShaderProgram, see FrameData.glsl
+uniform int hoverBoxId;                // parameter: index of box under the mouse cursor, -1 if none
+uniform int hoverFaceId;               // parameter: index of face under the mouse cursor
+
+// face whose color is stored in each corner, see BoxMesh::CornerFaces
+const int cornerFaces[8] = int[8](0, 1, 5, 3, 4, 2, -1, -1);
+
+void main() {
+  // Mind multiplication order for matrixes
+  gl_Position = worldToView * vec4(position, 1.0);
+  fragPos = position;
+  fragColor = color;
+  // tint box under mouse cursor, 8 corners per box
+  if (gl_VertexID / 8 == hoverBoxId)
+    fragColor = mix(color, vec3(1.0, 0.8, 0.2), cornerFaces[gl_VertexID % 8] == hoverFaceId ? 0.7 : 0.3);
+}
@@ -9,7 +9,7 @@ layout(location = 1) in vec2 texinfo;     // input:  attribute with index '1' wi
 out vec2 texCoord;                        // output: computed texture coordinates
 //flat out float texID;                     // output: texture ID - mind the 'flat' attribute (disables interpolation)!
 
-uniform mat4 worldToView;                 // parameter: the camera matrix
+// uniform block FrameData (worldToView, cameraPos, lightPos, lightColor) is inserted by ShaderProgram, see FrameData.glsl
 
 void main() {
   gl_Position = worldToView * vec4(position, 1.0);
@@ -10,13 +10,18 @@ out vec3 fragColor;                    // output: fragment color
 out vec3 fragNormal;                   // output: fragment normal vector
 out vec3 fragPos;                      // output: fragment position in world coords
 
-uniform mat4 worldToView;              // parameter: the camera matrix
+// uniform block FrameData (worldToView, cameraPos, lightPos, lightColor) is inserted by ShaderProgram, see FrameData.glsl
+uniform int hoverBoxId;                // parameter: index of box under the mouse cursor, -1 if none
+uniform int hoverFaceId;               // parameter: index of face under the mouse cursor
 
 void main() {
   // Mind multiplication order for matrixes
   gl_Position = worldToView * vec4(position, 1.0);
   fragPos = position;
   fragColor = color;
+  // tint box under mouse cursor, 6 faces with 4 vertexes each per box
+  if (gl_VertexID / 24 == hoverBoxId)
+    fragColor = mix(color, vec3(1.0, 0.8, 0.2), (gl_VertexID % 24) / 4 == hoverFaceId ? 0.7 : 0.3);
   fragNormal = normal;
 }
 
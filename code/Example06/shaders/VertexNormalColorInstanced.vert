@@ -0,0 +1,40 @@
+#version 330
+
+// GLSL version 3.3
+// vertex shader for instanced boxes: all boxes share a unit cube, which is scaled and moved per box (instance)
+
+layout(location = 0) in vec3 position;    // input:  attribute with index '0' with 3 elements per vertex (unit cube)
+layout(location = 1) in vec3 normal;      // input:  attribute with index '1' with 3 elements per vertex
+layout(location = 3) in vec3 translation; // input:  attribute with index '3' with 3 elements per instance (box center)
+layout(location = 4) in vec3 scale;       // input:  attribute with index '4' with 3 elements per instance (box dimensions)
+layout(location = 5) in vec4 faceColor0;  // input:  attributes with index '5'...'10' with 4 elements (=rgba) per instance,
+layout(location = 6) in vec4 faceColor1;  //         one for each face (front, right, back, left, bottom, top)
+layout(location = 7) in vec4 faceColor2;
+layout(location = 8) in vec4 faceColor3;
+layout(location = 9) in vec4 faceColor4;
+layout(location = 10) in vec4 faceColor5;
+out vec3 fragColor;                       // output: fragment color
+out vec3 fragNormal;                      // output: fragment normal vector
+out vec3 fragPos;                         // output: fragment position in world coords
+
+// uniform block FrameData (worldToView, cameraPos, lightPos, lightColor) is inserted by ShaderProgram, see FrameData.glsl
+uniform int hoverBoxId;                   // parameter: index of box under the mouse cursor, -1 if none
+uniform int hoverFaceId;                  // parameter: index of face under the mouse cursor
+
+void main() {
+  vec3 worldPos = translation + scale * position;
+  // Mind multiplication order for matrixes
+  gl_Position = worldToView * vec4(worldPos, 1.0);
+  fragPos = worldPos;
+  // 6 faces with 4 vertexes each in the unit cube
+  int faceId = gl_VertexID / 4;
+  vec4 faceColors[6] = vec4[6](faceColor0, faceColor1, faceColor2, faceColor3, faceColor4, faceColor5);
+  vec3 color = faceColors[faceId].rgb;
+  fragColor = color;
+  // tint box under mouse cursor, the instance index is the box index
+  if (gl_InstanceID == hoverBoxId)
+    fragColor = mix(color, vec3(1.0, 0.8, 0.2), faceId == hoverFaceId ? 0.7 : 0.3);
+  // scaling with positive factors does not change the axis-aligned normals of the unit cube
+  fragNormal = normal;
+}
+
@@ -0,0 +1,28 @@
+#version 330 core
+
+// fragment shader with diffuse lighting for flat faces, the normal vector is computed from
+// the screen-space derivatives of the fragment position
+
+flat in vec3 fragColor;    // input: face color as rgb-value
+in vec3 fragPos;           // input: fragment position (world coords)
+
+out vec4 finalColor;       // output: final color value as rgba-value
+
+// uniform block FrameData (worldToView, cameraPos, lightPos, lightColor) is inserted by ShaderProgram, see FrameData.glsl
+
+void main() {
+  // ambient
+  float ambientStrength = 0.2;
+  vec3 ambient = ambientStrength * lightColor;
+
+  // diffuse; the derivatives span the plane of the triangle, and for front faces (counter-clockwise
+  // on screen) their cross product points outwards
+  vec3 norm = normalize(cross(dFdx(fragPos), dFdy(fragPos)));
+  vec3 lightDir = normalize(lightPos - fragPos);
+  float diff = max(dot(norm, lightDir), 0.0);
+  vec3 diffuse = diff * lightColor;
+
+  vec3 result = (ambient + diffuse) * fragColor;
+
+  finalColor = vec4(result, 1.0);
+}
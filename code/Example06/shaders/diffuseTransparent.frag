@@ -8,8 +8,7 @@ in vec3 fragPos;           // input: fragment position (world coords)
 
 out vec4 finalColor;       // output: final color value as rgba-value
 
-uniform vec3 lightPos;     // parameter: light position as vec3 (world coords)
-uniform vec3 lightColor;   // parameter: light color as rgb
+// uniform block FrameData (worldToView, cameraPos, lightPos, lightColor) is inserted by ShaderProgram, see FrameData.glsl
 
 void main() {
   // ambient
@@ -0,0 +1,10 @@
+#version 330 core
+
+// fragment shader for rendering object and face ids into an integer framebuffer
+
+flat in uvec3 pickId;  // input: object type, object id and face id
+out uvec4 finalId;     // output: ids written to the integer color attachment
+
+void main() {
+  finalId = uvec4(pickId, 1u);
+}
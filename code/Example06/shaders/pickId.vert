@@ -0,0 +1,33 @@
+#version 330
+
+// GLSL version 3.3
+// vertex shader for rendering object and face ids into an integer framebuffer
+
+layout(location = 0) in vec3 position;    // input:  attribute with index '0' with 3 elements per vertex
+layout(location = 3) in vec3 translation; // input:  attribute with index '3' with 3 elements per instance (instanced boxes only)
+layout(location = 4) in vec3 scale;       // input:  attribute with index '4' with 3 elements per instance (instanced boxes only)
+flat out uvec3 pickId;                    // output: object type, object id and face id - 'flat', ids must not be interpolated
+
+// uniform block FrameData (worldToView, cameraPos, lightPos, lightColor) is inserted by ShaderProgram, see FrameData.glsl
+uniform uint objectType;                  // parameter: type of object rendered (0 is reserved for background)
+uniform int verticesPerObject;            // parameter: number of vertexes per object, 4 vertexes per face
+                                          //            (or 8 for boxes with shared corners)
+uniform bool instanced;                   // parameter: if true, one instance is drawn per object and position is a unit cube vertex
+
+void main() {
+  if (instanced) {
+    // Mind multiplication order for matrixes
+    gl_Position = worldToView * vec4(translation + scale * position, 1.0);
+    pickId = uvec3(objectType, uint(gl_InstanceID), uint(gl_VertexID / 4));
+    return;
+  }
+  gl_Position = worldToView * vec4(position, 1.0);
+  // with indexed drawing, gl_VertexID is the vertex index, and all objects store their vertexes consecutively
+  int objectId = gl_VertexID / verticesPerObject;
+  int faceId = (gl_VertexID % verticesPerObject) / 4;
+  // shared box corners: pickId is taken from the last (provoking) vertex of each triangle, which is the
+  // corner that stores the face, see BoxMesh::CornerFaces
+  if (verticesPerObject == 8)
+    faceId = int[8](0, 1, 5, 3, 4, 2, -1, -1)[gl_VertexID % 8];
+  pickId = uvec3(objectType, uint(objectId), uint(faceId));
+}
@@ -7,7 +7,7 @@ layout(location = 0) in vec3 position; // input:  attribute with index '0' with
 layout(location = 1) in vec3 color;    // input:  attribute with index '1' with 3 elements (=rgb) per vertex
 out vec4 fragColor;                    // output: computed fragmentation color
 
-uniform mat4 worldToView;            // parameter: the camera matrix
+// uniform block FrameData (worldToView, cameraPos, lightPos, lightColor) is inserted by ShaderProgram, see FrameData.glsl
 
 void main() {
   // Mind multiplication order for matrixes